@@ -0,0 +1,364 @@
+#include <TPP/Backend/Builder.hpp>
+#include <TPP/Frontend/Arena.hpp>
+#include <TPP/Frontend/Expression.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Parser.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <vector>
+
+struct Workload
+{
+	const char *Name;
+	void (*Generate)(const std::filesystem::path &directory, unsigned scale);
+};
+
+struct Result
+{
+	std::string Name;
+	size_t Files = 0;
+	size_t Bytes = 0;
+	size_t Tokens = 0;
+	size_t Nodes = 0;
+	size_t Instructions = 0;
+
+	// best of all iterations, in seconds
+	double Lex = std::numeric_limits<double>::max();
+	double Parse = std::numeric_limits<double>::max();
+	double GenIR = std::numeric_limits<double>::max();
+	double Verify = std::numeric_limits<double>::max();
+	double Print = std::numeric_limits<double>::max();
+};
+
+static void small_functions(const std::filesystem::path &directory, unsigned scale)
+{
+	std::ofstream out(directory / "main.t++");
+	out << "def f64 f0(f64 x) = x\n";
+	for (unsigned i = 1; i < 2000 * scale; ++i) out << "def f64 f" << i << "(f64 x) = x * " << i % 7 + 1 << " + f" << i - 1 << "(x)\n";
+}
+
+static void nested_groups(const std::filesystem::path &directory, unsigned scale)
+{
+	static constexpr unsigned DEPTH = 64;
+
+	std::ofstream out(directory / "main.t++");
+	for (unsigned k = 0; k < 50 * scale; ++k)
+	{
+		// a group on a line of its own would continue the previous expression as a call, so each one is an operand
+		out << "def f64 g" << k << "(f64 v0) = (\n";
+		for (unsigned d = 1; d <= DEPTH; ++d) out << std::string(d, '\t') << "def f64 v" << d << " = v" << d - 1 << " + " << d << "\n" << std::string(d, '\t') << "v" << d << " * (\n";
+		out << std::string(DEPTH + 1, '\t') << "v" << DEPTH << "\n";
+		for (unsigned d = DEPTH; d > 0; --d) out << std::string(d, '\t') << ")\n";
+		out << ")\n";
+	}
+}
+
+static void binary_chains(const std::filesystem::path &directory, unsigned scale)
+{
+	static constexpr unsigned LENGTH = 256;
+	static constexpr const char *OPS[] = { " + ", " * ", " - ", " / " };
+
+	std::ofstream out(directory / "main.t++");
+	for (unsigned k = 0; k < 200 * scale; ++k)
+	{
+		out << "def f64 c" << k << "(f64 a, f64 b) = a";
+		for (unsigned i = 0; i < LENGTH; ++i) out << OPS[(i + k) % std::size(OPS)] << (i % 2 ? "a" : "b");
+		out << "\n";
+	}
+}
+
+static void wide_structs(const std::filesystem::path &directory, unsigned scale)
+{
+	static constexpr unsigned WIDTH = 256;
+	static constexpr const char *TYPES[] = { "f64", "i32", "i8", "i64" };
+
+	std::ofstream out(directory / "main.t++");
+	for (unsigned k = 0; k < 50 * scale; ++k)
+	{
+		out << "struct w" << k << " {";
+		for (unsigned i = 0; i < WIDTH; ++i) out << (i ? ", " : " ") << TYPES[i % std::size(TYPES)] << " e" << i;
+		out << " }\ndef w" << k << " g" << k << "\n";
+	}
+}
+
+static void include_fans(const std::filesystem::path &directory, unsigned scale)
+{
+	static constexpr unsigned FUNCTIONS = 10;
+
+	{
+		std::ofstream out(directory / "common.t++");
+		out << "def i32 printf([i8] format, ?)\ndef f64 common(f64 x) = x * x\n";
+	}
+
+	std::ofstream main(directory / "main.t++");
+	for (unsigned k = 0; k < 200 * scale; ++k)
+	{
+		auto name = "unit" + std::to_string(k) + ".t++";
+		main << "include \"" << name << "\"\n";
+
+		std::ofstream out(directory / name);
+		out << "include \"common.t++\"\n";
+		for (unsigned i = 0; i < FUNCTIONS; ++i) out << "def f64 u" << k << "_" << i << "(f64 x) = common(x) + " << i << "\n";
+	}
+}
+
+static const Workload WORKLOADS[] = {
+	{ "small_functions", small_functions },
+	{ "nested_groups", nested_groups },
+	{ "binary_chains", binary_chains },
+	{ "wide_structs", wide_structs },
+	{ "include_fans", include_fans },
+};
+
+static size_t count_nodes(const tpp::ExprPtr &ptr)
+{
+	if (!ptr) return 0;
+
+	size_t count = 1;
+	switch (ptr->Kind)
+	{
+	case tpp::ExpressionKind_DefFunction: count += count_nodes(ptr->As<tpp::DefFunctionExpression>()->Body); break;
+	case tpp::ExpressionKind_DefVariable:
+	{
+		auto e = ptr->As<tpp::DefVariableExpression>();
+		count += count_nodes(e->Size) + count_nodes(e->Init);
+		break;
+	}
+	case tpp::ExpressionKind_Return: count += count_nodes(ptr->As<tpp::ReturnExpression>()->Result); break;
+	case tpp::ExpressionKind_For:
+	{
+		auto e = ptr->As<tpp::ForExpression>();
+		count += count_nodes(e->From) + count_nodes(e->To) + count_nodes(e->Step) + count_nodes(e->Body);
+		break;
+	}
+	case tpp::ExpressionKind_While:
+	{
+		auto e = ptr->As<tpp::WhileExpression>();
+		count += count_nodes(e->Condition) + count_nodes(e->Body);
+		break;
+	}
+	case tpp::ExpressionKind_If:
+	{
+		auto e = ptr->As<tpp::IfExpression>();
+		count += count_nodes(e->Condition) + count_nodes(e->BranchTrue) + count_nodes(e->BranchFalse);
+		break;
+	}
+	case tpp::ExpressionKind_Group:
+		for (const auto &e : ptr->As<tpp::GroupExpression>()->Body) count += count_nodes(e);
+		break;
+	case tpp::ExpressionKind_Binary:
+	{
+		auto e = ptr->As<tpp::BinaryExpression>();
+		count += count_nodes(e->Lhs) + count_nodes(e->Rhs);
+		break;
+	}
+	case tpp::ExpressionKind_Call:
+		for (const auto &e : ptr->As<tpp::CallExpression>()->Args) count += count_nodes(e);
+		break;
+	case tpp::ExpressionKind_Index:
+	{
+		auto e = ptr->As<tpp::IndexExpression>();
+		count += count_nodes(e->Array) + count_nodes(e->Index);
+		break;
+	}
+	case tpp::ExpressionKind_Member: count += count_nodes(ptr->As<tpp::MemberExpression>()->Object); break;
+	case tpp::ExpressionKind_Unary: count += count_nodes(ptr->As<tpp::UnaryExpression>()->Operand); break;
+	case tpp::ExpressionKind_Object:
+		for (const auto &e : ptr->As<tpp::ObjectExpression>()->Init) count += count_nodes(e);
+		break;
+	case tpp::ExpressionKind_Array:
+	{
+		auto e = ptr->As<tpp::ArrayExpression>();
+		count += count_nodes(e->Size) + count_nodes(e->Init);
+		break;
+	}
+	case tpp::ExpressionKind_Sync: count += count_nodes(ptr->As<tpp::SyncExpression>()->Future); break;
+	default: break;
+	}
+	return count;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point begin) { return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(); }
+
+static Result run(const Workload &workload, unsigned scale, unsigned iterations)
+{
+	llvm::SmallString<128> directory;
+	if (auto ec = llvm::sys::fs::createUniqueDirectory("t++-bench", directory)) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to create temporary directory: %s", ec.message().c_str());
+	std::filesystem::path root(directory.str().str());
+	workload.Generate(root, scale);
+
+	Result result;
+	result.Name = workload.Name;
+
+	std::vector<std::pair<std::filesystem::path, std::unique_ptr<llvm::MemoryBuffer>>> sources;
+	for (const auto &entry : std::filesystem::directory_iterator(root))
+	{
+		auto buffer = llvm::MemoryBuffer::getFile(entry.path().string());
+		if (!buffer) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to open file: %s", entry.path().string().c_str());
+		result.Bytes += (*buffer)->getBufferSize();
+		sources.emplace_back(entry.path(), std::move(*buffer));
+	}
+	result.Files = sources.size();
+
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		auto begin = std::chrono::steady_clock::now();
+		result.Tokens = 0;
+		for (const auto &[path, buffer] : sources) result.Tokens += tpp::Parser::CountTokens(buffer->getBuffer(), path);
+		result.Lex = std::min(result.Lex, seconds_since(begin));
+
+		tpp::Arena ast;
+		std::vector<tpp::ExprPtr> exprs;
+		begin = std::chrono::steady_clock::now();
+		tpp::Parser::ParseFile(root / "main.t++", ast, [&exprs](const tpp::ExprPtr &ptr) { exprs.push_back(ptr); });
+		result.Parse = std::min(result.Parse, seconds_since(begin));
+
+		result.Nodes = 0;
+		for (const auto &ptr : exprs) result.Nodes += count_nodes(ptr);
+
+		tpp::Builder builder((root / "main.t++").string());
+		begin = std::chrono::steady_clock::now();
+		for (const auto &ptr : exprs) builder.GenIR(ptr);
+		builder.Finish();
+		result.GenIR = std::min(result.GenIR, seconds_since(begin));
+
+		result.Instructions = 0;
+		for (const auto &function : builder.Module()) result.Instructions += function.getInstructionCount();
+
+		begin = std::chrono::steady_clock::now();
+		if (llvm::verifyModule(builder.Module(), &llvm::errs())) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to verify module");
+		result.Verify = std::min(result.Verify, seconds_since(begin));
+
+		std::string ir;
+		llvm::raw_string_ostream stream(ir);
+		begin = std::chrono::steady_clock::now();
+		builder.Module().print(stream, nullptr);
+		stream.flush();
+		result.Print = std::min(result.Print, seconds_since(begin));
+	}
+
+	std::filesystem::remove_all(root);
+	return result;
+}
+
+static double rate(size_t count, double seconds) { return seconds > 0 ? count / seconds : 0; }
+
+static void print_text(const std::vector<Result> &results)
+{
+	printf("%-16s %9s %9s %9s %9s %9s %12s %12s %12s\n", "workload", "lex ms", "parse ms", "genir ms", "verify ms", "print ms", "tokens/s", "nodes/s", "insts/s");
+	for (const auto &r : results)
+		printf(
+			"%-16s %9.3f %9.3f %9.3f %9.3f %9.3f %12.0f %12.0f %12.0f\n",
+			r.Name.c_str(),
+			r.Lex * 1e3,
+			r.Parse * 1e3,
+			r.GenIR * 1e3,
+			r.Verify * 1e3,
+			r.Print * 1e3,
+			rate(r.Tokens, r.Lex),
+			rate(r.Nodes, r.Parse),
+			rate(r.Instructions, r.GenIR));
+}
+
+static void print_json(const std::vector<Result> &results, unsigned scale, unsigned iterations)
+{
+	printf("{\"scale\":%u,\"iterations\":%u,\"workloads\":[", scale, iterations);
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const auto &r = results[i];
+		printf(
+			"%s{\"name\":\"%s\",\"files\":%zu,\"bytes\":%zu,\"tokens\":%zu,\"nodes\":%zu,\"instructions\":%zu,"
+			"\"seconds\":{\"lex\":%.9f,\"parse\":%.9f,\"genir\":%.9f,\"verify\":%.9f,\"print\":%.9f},"
+			"\"tokens_per_second\":%.1f,\"nodes_per_second\":%.1f,\"instructions_per_second\":%.1f}",
+			i ? "," : "",
+			r.Name.c_str(),
+			r.Files,
+			r.Bytes,
+			r.Tokens,
+			r.Nodes,
+			r.Instructions,
+			r.Lex,
+			r.Parse,
+			r.GenIR,
+			r.Verify,
+			r.Print,
+			rate(r.Tokens, r.Lex),
+			rate(r.Nodes, r.Parse),
+			rate(r.Instructions, r.GenIR));
+	}
+	printf("]}\n");
+}
+
+// the whole argument has to be a number, at least min
+static bool parse_unsigned(const char *str, unsigned &value, unsigned min = 0)
+{
+	char *end;
+	errno = 0;
+	auto result = strtoul(str, &end, 10);
+	if (!isdigit((unsigned char) *str) || *end || errno || result > std::numeric_limits<unsigned>::max()) return false;
+	value = std::max(min, (unsigned) result);
+	return true;
+}
+
+static int usage()
+{
+	std::cout << "usage: t++-bench [--json] [--scale=<n>] [--iterations=<n>] [workload...]" << std::endl;
+	std::cout << "workloads:";
+	for (const auto &workload : WORKLOADS) std::cout << " " << workload.Name;
+	std::cout << std::endl;
+	return 1;
+}
+
+int main(const int argc, const char **argv)
+{
+	bool json = false;
+	unsigned scale = 1;
+	unsigned iterations = 5;
+	std::vector<const Workload *> selected;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "--json") json = true;
+		else if (arg.rfind("--scale=", 0) == 0)
+		{
+			if (!parse_unsigned(arg.c_str() + 8, scale, 1)) return usage();
+		}
+		else if (arg.rfind("--iterations=", 0) == 0)
+		{
+			if (!parse_unsigned(arg.c_str() + 13, iterations, 1)) return usage();
+		}
+		else if (arg[0] != '-')
+		{
+			auto it = std::find_if(std::begin(WORKLOADS), std::end(WORKLOADS), [&arg](const Workload &workload) { return arg == workload.Name; });
+			if (it == std::end(WORKLOADS)) return usage();
+			selected.push_back(it);
+		}
+		else return usage();
+	}
+
+	if (selected.empty())
+		for (const auto &workload : WORKLOADS) selected.push_back(&workload);
+
+	std::vector<Result> results;
+	for (auto workload : selected) results.push_back(run(*workload, scale, iterations));
+
+	if (json) print_json(results, scale, iterations);
+	else print_text(results);
+}
@@ -0,0 +1,352 @@
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+#include <optional>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+struct Benchmark
+{
+	const char *Name;
+	const char *Source;
+	// fixed command line; stdin is empty and the programs take no other input, so every run sees the same work
+	std::vector<const char *> Args;
+};
+
+struct Result
+{
+	std::string Name;
+	unsigned Level = 0;
+	bool Ok = false;
+	// best of all iterations; instructions are -1 when no hardware counter is available
+	double Seconds = std::numeric_limits<double>::max();
+	int64_t Instructions = -1;
+	uint64_t CodeSize = 0;
+};
+
+static const Benchmark BENCHMARKS[] = {
+	{ "mandel", "bench/mandel.t++", {} },
+	{ "donut", "bench/donut.t++", {} },
+	{ "fib", "bench/fib.t++", {} },
+};
+
+static int open_counter(pid_t pid)
+{
+#ifdef __linux__
+	perf_event_attr attr{};
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.disabled = 1;
+	attr.enable_on_exec = 1;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0));
+#else
+	return -1;
+#endif
+}
+
+static int64_t read_counter(int counter)
+{
+	if (counter < 0) return -1;
+
+	int64_t value = -1;
+	if (read(counter, &value, sizeof(value)) != sizeof(value)) value = -1;
+	close(counter);
+	return value;
+}
+
+// runs the program in 'directory' with no input and no output; the child waits on a pipe until its counter is attached, so only the program itself is counted
+static bool execute(const std::string &program, const std::vector<const char *> &args, const std::filesystem::path &directory, double &seconds, int64_t &instructions)
+{
+	std::vector<char *> argv;
+	argv.push_back(const_cast<char *>(program.c_str()));
+	for (auto arg : args) argv.push_back(const_cast<char *>(arg));
+	argv.push_back(nullptr);
+
+	int ready[2];
+	if (pipe(ready)) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to create pipe: %s", strerror(errno));
+
+	auto pid = fork();
+	if (pid < 0) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to fork: %s", strerror(errno));
+	if (pid == 0)
+	{
+		close(ready[1]);
+		char go;
+		if (read(ready[0], &go, 1) != 1) _exit(127);
+
+		auto null = open("/dev/null", O_RDWR);
+		dup2(null, STDIN_FILENO);
+		dup2(null, STDOUT_FILENO);
+		dup2(null, STDERR_FILENO);
+		if (chdir(directory.c_str())) _exit(127);
+		execv(program.c_str(), argv.data());
+		_exit(127);
+	}
+
+	close(ready[0]);
+	auto counter = open_counter(pid);
+
+	auto begin = std::chrono::steady_clock::now();
+	if (write(ready[1], "x", 1) != 1) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to start %s", program.c_str());
+	close(ready[1]);
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	instructions = read_counter(counter);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool compile(const std::string &compiler, unsigned level, const std::vector<std::string> &options, const std::filesystem::path &source)
+{
+	auto flag = "-O" + std::to_string(level);
+	auto path = source.string();
+
+	std::vector<llvm::StringRef> args = { compiler, flag };
+	for (const auto &option : options) args.push_back(option);
+	args.push_back(path);
+
+	std::string message;
+	auto status = llvm::sys::ExecuteAndWait(compiler, args, std::nullopt, {}, 0, 0, &message);
+	if (!message.empty()) std::cerr << "failed to run " << compiler << ": " << message << std::endl;
+	return status == 0;
+}
+
+static uint64_t code_size(const std::string &filename)
+{
+	auto object = llvm::object::ObjectFile::createObjectFile(filename);
+	if (!object) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to read object %s: %s", filename.c_str(), llvm::toString(object.takeError()).c_str());
+
+	uint64_t size = 0;
+	for (const auto &section : object->getBinary()->sections())
+		if (section.isText()) size += section.getSize();
+	return size;
+}
+
+static Result run(const std::string &compiler, const std::filesystem::path &examples, const Benchmark &benchmark, unsigned level, unsigned iterations, const std::filesystem::path &directory)
+{
+	Result result;
+	result.Name = benchmark.Name;
+	result.Level = level;
+
+	auto object = (directory / (std::string(benchmark.Name) + ".o")).string();
+	auto executable = (directory / benchmark.Name).string();
+	auto source = examples / benchmark.Source;
+	if (!compile(compiler, level, { "-c", "-o", object }, source) || !compile(compiler, level, { "-o", executable }, source)) return result;
+	result.CodeSize = code_size(object);
+
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		double seconds;
+		int64_t instructions;
+		if (!execute(executable, benchmark.Args, directory, seconds, instructions)) return result;
+
+		result.Seconds = std::min(result.Seconds, seconds);
+		if (instructions >= 0) result.Instructions = result.Instructions < 0 ? instructions : std::min(result.Instructions, instructions);
+	}
+	result.Ok = true;
+	return result;
+}
+
+static std::vector<Result> load_baseline(const std::string &filename)
+{
+	auto buffer = llvm::MemoryBuffer::getFile(filename);
+	if (!buffer) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to open baseline %s: %s", filename.c_str(), buffer.getError().message().c_str());
+
+	auto json = llvm::json::parse((*buffer)->getBuffer());
+	if (!json) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to parse baseline %s: %s", filename.c_str(), llvm::toString(json.takeError()).c_str());
+
+	std::vector<Result> results;
+	auto object = json->getAsObject();
+	auto entries = object ? object->getArray("results") : nullptr;
+	if (!entries) tpp::error(tpp::SourceLocation::UNKNOWN, "baseline %s has no results", filename.c_str());
+
+	for (const auto &value : *entries)
+	{
+		auto entry = value.getAsObject();
+		if (!entry) continue;
+
+		Result result;
+		result.Name = entry->getString("name").value_or("").str();
+		result.Level = static_cast<unsigned>(entry->getInteger("level").value_or(0));
+		result.Seconds = entry->getNumber("seconds").value_or(0);
+		result.Instructions = entry->getInteger("instructions").value_or(-1);
+		result.CodeSize = static_cast<uint64_t>(entry->getInteger("code_size").value_or(0));
+		result.Ok = true;
+		results.push_back(result);
+	}
+	return results;
+}
+
+static void save_baseline(const std::string &filename, const std::vector<Result> &results)
+{
+	llvm::json::Array entries;
+	for (const auto &r : results)
+		if (r.Ok)
+			entries.push_back(llvm::json::Object{
+				{ "name", r.Name },
+				{ "level", r.Level },
+				{ "seconds", r.Seconds },
+				{ "instructions", r.Instructions },
+				{ "code_size", static_cast<int64_t>(r.CodeSize) },
+			});
+
+	std::error_code ec;
+	llvm::raw_fd_ostream stream(filename, ec, llvm::sys::fs::OF_Text);
+	if (ec) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to open file %s: %s", filename.c_str(), ec.message().c_str());
+	stream << llvm::formatv("{0:2}", llvm::json::Value(llvm::json::Object{ { "results", std::move(entries) } })) << '\n';
+}
+
+static double change(double value, double base) { return base > 0 ? (value - base) / base * 100 : 0; }
+
+// prints one row per run and returns whether any of them failed or got slower than the baseline allows
+static bool report(const std::vector<Result> &results, const std::vector<Result> &baseline, double threshold)
+{
+	bool failed = false;
+	printf("%-12s %5s %12s %16s %12s %9s %9s\n", "benchmark", "level", "wall ms", "instructions", "code bytes", "wall", "insts");
+	for (const auto &r : results)
+	{
+		auto level = "-O" + std::to_string(r.Level);
+		if (!r.Ok)
+		{
+			printf("%-12s %5s %12s\n", r.Name.c_str(), level.c_str(), "failed");
+			failed = true;
+			continue;
+		}
+
+		auto instructions = r.Instructions < 0 ? std::string("n/a") : std::to_string(r.Instructions);
+		printf("%-12s %5s %12.3f %16s %12llu", r.Name.c_str(), level.c_str(), r.Seconds * 1e3, instructions.c_str(), (unsigned long long) r.CodeSize);
+
+		auto base = std::find_if(baseline.begin(), baseline.end(), [&r](const Result &b) { return b.Name == r.Name && b.Level == r.Level; });
+		if (base == baseline.end())
+		{
+			printf("\n");
+			continue;
+		}
+
+		auto wall = change(r.Seconds, base->Seconds);
+		bool counted = r.Instructions >= 0 && base->Instructions > 0;
+		auto insts = counted ? change(double(r.Instructions), double(base->Instructions)) : 0;
+		bool slower = wall > threshold || insts > threshold;
+		printf(" %+8.1f%%", wall);
+		if (counted) printf(" %+8.1f%%", insts);
+		else printf(" %9s", "n/a");
+		printf(slower ? "  SLOWER\n" : "\n");
+		failed |= slower;
+	}
+	return failed;
+}
+
+// the whole argument has to be a number, at least min
+static bool parse_unsigned(const char *str, unsigned &value, unsigned min = 0)
+{
+	char *end;
+	errno = 0;
+	auto result = strtoul(str, &end, 10);
+	if (!isdigit((unsigned char) *str) || *end || errno || result > std::numeric_limits<unsigned>::max()) return false;
+	value = std::max(min, (unsigned) result);
+	return true;
+}
+
+static int usage()
+{
+	std::cout << "usage: t++-runtime-bench [-O0|-O1|-O2|-O3]... [--iterations=<n>] [--threshold=<percent>] [--baseline=<file>] [--update] [--compiler=<t++>] [--examples=<dir>] [benchmark...]" << std::endl;
+	std::cout << "benchmarks:";
+	for (const auto &benchmark : BENCHMARKS) std::cout << " " << benchmark.Name;
+	std::cout << std::endl;
+	return 1;
+}
+
+int main(const int argc, const char **argv)
+{
+	std::string compiler = TPP_COMPILER;
+	std::filesystem::path examples = TPP_EXAMPLES;
+	std::string baseline_file = "runtime-baseline.json";
+	bool update = false;
+	double threshold = 5;
+	unsigned iterations = 3;
+	std::vector<unsigned> levels;
+	std::vector<const Benchmark *> selected;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+
+		if (arg.size() == 3 && arg.rfind("-O", 0) == 0 && arg[2] >= '0' && arg[2] <= '3') levels.push_back(arg[2] - '0');
+		else if (arg.rfind("--iterations=", 0) == 0)
+		{
+			if (!parse_unsigned(arg.c_str() + 13, iterations, 1)) return usage();
+		}
+		else if (arg.rfind("--threshold=", 0) == 0)
+		{
+			char *end;
+			threshold = strtod(arg.c_str() + 12, &end);
+			if (end == arg.c_str() + 12 || *end) return usage();
+		}
+		else if (arg.rfind("--baseline=", 0) == 0) baseline_file = arg.substr(11);
+		else if (arg == "--update") update = true;
+		else if (arg.rfind("--compiler=", 0) == 0) compiler = arg.substr(11);
+		else if (arg.rfind("--examples=", 0) == 0) examples = arg.substr(11);
+		else if (arg[0] != '-')
+		{
+			auto it = std::find_if(std::begin(BENCHMARKS), std::end(BENCHMARKS), [&arg](const Benchmark &benchmark) { return arg == benchmark.Name; });
+			if (it == std::end(BENCHMARKS)) return usage();
+			selected.push_back(it);
+		}
+		else return usage();
+	}
+
+	if (levels.empty()) levels = { 0, 1, 2, 3 };
+	if (selected.empty())
+		for (const auto &benchmark : BENCHMARKS) selected.push_back(&benchmark);
+
+	llvm::SmallString<128> directory;
+	if (auto ec = llvm::sys::fs::createUniqueDirectory("t++-runtime", directory)) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to create temporary directory: %s", ec.message().c_str());
+
+	std::vector<Result> results;
+	for (auto benchmark : selected)
+		for (auto level : levels) results.push_back(run(compiler, examples, *benchmark, level, iterations, directory.str().str()));
+	std::filesystem::remove_all(directory.str().str());
+
+	// the first run, or an explicit update, records the baseline that later runs are judged against
+	std::vector<Result> baseline;
+	bool record = update || !std::filesystem::exists(baseline_file);
+	if (!record) baseline = load_baseline(baseline_file);
+
+	bool failed = report(results, baseline, threshold);
+	if (record)
+	{
+		save_baseline(baseline_file, results);
+		std::cout << "baseline written to " << baseline_file << std::endl;
+	}
+	return failed ? 1 : 0;
+}
@@ -1,20 +1,42 @@
 #pragma once
 
+#include <TPP/Backend/Optimizer.hpp>
 #include <TPP/Backend/Value.hpp>
 #include <TPP/Frontend/Expression.hpp>
 #include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Name.hpp>
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBufferRef.h>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace tpp
 {
+	enum ABIKind
+	{
+		ABIKind_Direct,
+		ABIKind_Coerce,
+		ABIKind_Indirect,
+	};
+
+	// how a value crosses a call: as it is, as the one or two registers it is classified into, or through a pointer to memory
+	struct ABIInfo
+	{
+		ABIKind Kind;
+		llvm::Type *IRType;
+	};
+
 	struct FunctionInfo
 	{
 		llvm::Function *Function;
@@ -22,20 +44,38 @@ namespace tpp
 		TypePtr Result;
 		std::vector<TypePtr> Args;
 		bool IsVarArg;
+
+		// first declared without a body, so it may be c code that takes large aggregates byval as sysv says
+		bool IsExtern;
 	};
 
 	class Builder
 	{
 	public:
-		Builder(const std::string& source_filename);
+		Builder(const std::string &source_filename, Optimizer *optimizer = nullptr);
+		Builder(const Builder &parent, Optimizer *optimizer = nullptr);
 
 		llvm::LLVMContext &Context() const;
 		llvm::Module &Module() const;
 		llvm::IRBuilder<> &IRBuilder() const;
 
+		std::unique_ptr<llvm::LLVMContext> ReleaseContext();
+		std::unique_ptr<llvm::Module> ReleaseModule();
+
 		bool IsGlobal() const;
 
+		void Finish();
+		void Link(llvm::ArrayRef<llvm::MemoryBufferRef> modules);
+
+		const FunctionInfo &DeclareFunction(const DefFunctionExpression &e);
+
+		// functions and globals declared so far; a body lowered later is limited to that many, so it sees what a serial build saw at its definition
+		size_t Declarations() const;
+		void LimitDeclarations(size_t declarations);
+
 		ValuePtr GenIR(const ExprPtr &ptr);
+		// like GenIR(ptr), but an unsuffixed literal takes the given type if its value fits
+		ValuePtr GenIR(const ExprPtr &ptr, const TypePtr &context);
 		llvm::Type *GenIR(const TypePtr &ptr);
 
 		llvm::Value *CreateAlloca(llvm::Type *type);
@@ -46,12 +86,30 @@ namespace tpp
 	private:
 		void Push();
 		void Pop();
+		void Bind(const Name &name, const ValuePtr &value);
+
+		// functions and globals declared after the limit do not exist for the body being lowered
+		bool IsDeclared(const Name &name) const;
+		const FunctionInfo *FindFunction(const Name &name) const;
+
+		llvm::Type *CreateIRType(const TypePtr &ptr);
 
 		ValuePtr DefineVariable(const Name &name, const TypePtr &type, const ValuePtr &value);
 
+		ABIInfo GetABI(const TypePtr &type);
+		void SetABIAttributes(const FunctionInfo &info);
+		llvm::Value *CreateCoercionSlot(llvm::Type *type, llvm::Type *coerced);
+
+		// returns from the function whose body is being lowered, in the way its result crosses the call
+		void CreateReturn(ValuePtr result, const SourceLocation &location);
+
+		// verifies a finished function body and runs the per-function pipeline on it
+		void FinishFunction(llvm::Function &function, const SourceLocation &location);
+
 		TypePtr GetHigherOrder(const TypePtr &a, const TypePtr &b);
 
 		std::pair<ValuePtr, ValuePtr> CreateHigherOrderCast(const ValuePtr &a, const ValuePtr &b);
+		TypePtr GetBoolType(const TypePtr &type);
 
 		ValuePtr CreateAssign(const ValuePtr &dest, const ValuePtr &src);
 
@@ -68,8 +126,39 @@ namespace tpp
 		ValuePtr CreateDiv(const ValuePtr &lhs, const ValuePtr &rhs);
 		ValuePtr CreateRem(const ValuePtr &lhs, const ValuePtr &rhs);
 
+		ValuePtr CreateAnd(const ValuePtr &lhs, const ValuePtr &rhs);
+		ValuePtr CreateOr(const ValuePtr &lhs, const ValuePtr &rhs);
+		ValuePtr CreateXor(const ValuePtr &lhs, const ValuePtr &rhs);
+		ValuePtr CreateShl(const ValuePtr &lhs, const ValuePtr &rhs);
+		ValuePtr CreateAShr(const ValuePtr &lhs, const ValuePtr &rhs);
+		ValuePtr CreateLShr(const ValuePtr &lhs, const ValuePtr &rhs);
+
+		std::pair<ValuePtr, ValuePtr> GenOperands(const ExprPtr &lhs, const ExprPtr &rhs);
+		ValuePtr CreateNumber(const NumberExpression &e, const TypePtr &type);
+
+		llvm::Value *CreateBool(const ValuePtr &value);
+		ValuePtr CreateLogical(const BinaryExpression &e);
+
+		llvm::Value *CreateCondition(const ExprPtr &ptr);
+		llvm::MDNode *CreateLoopMetadata(const LoopHints &hints);
+		ValuePtr CreateLoop(const ForExpression &e, const TypePtr &counter_type, const ValuePtr &from, const ValuePtr &to, const ValuePtr &step);
+		void CreateParallelFor(const ForExpression &e, const TypePtr &counter_type, const ValuePtr &from, const ValuePtr &to);
+		ValuePtr CreateLoopResult(const TypePtr &type, llvm::Value *last, llvm::BasicBlock *guard, llvm::BasicBlock *latch);
+
+		// a result that comes back through memory is written to result_slot if given, to a fresh one otherwise
+		ValuePtr CreateCall(const FunctionInfo &info, const std::vector<ValuePtr> &args, llvm::Value *result_slot = nullptr);
+		ValuePtr CreateSpawn(const CallExpression &e, const FunctionInfo &info, const std::vector<ValuePtr> &args);
+
+		// min, max, fma, select, shuffle and the reduce_ family; null if the callee names none of them
+		ValuePtr CreateBuiltin(const CallExpression &e);
+		ValuePtr CreateElements(const ObjectExpression &e, const TypePtr &type);
+		ValuePtr CreateElement(const IndexExpression &e, const ValuePtr &array, const ValuePtr &index);
+		ValuePtr CreateLane(const ValuePtr &vector, llvm::Value *lane);
+		ValuePtr CreateSwizzle(const MemberExpression &e, const ValuePtr &vector);
+
 		ValuePtr GenIR(const DefFunctionExpression &e);
 		ValuePtr GenIR(const DefVariableExpression &e);
+		ValuePtr GenIR(const ReturnExpression &e);
 		ValuePtr GenIR(const ForExpression &e);
 		ValuePtr GenIR(const WhileExpression &e);
 		ValuePtr GenIR(const IfExpression &e);
@@ -86,6 +175,7 @@ namespace tpp
 		ValuePtr GenIR(const UnaryExpression &e);
 		ValuePtr GenIR(const ObjectExpression &e);
 		ValuePtr GenIR(const ArrayExpression &e);
+		ValuePtr GenIR(const SyncExpression &e);
 
 		const char *TypeToString(llvm::Type *type);
 
@@ -94,11 +184,31 @@ namespace tpp
 		std::unique_ptr<llvm::Module> m_Module;
 		std::unique_ptr<llvm::IRBuilder<>> m_Builder;
 
-		llvm::Function *m_Global;
+		Optimizer *m_Optimizer;
+		const Builder *m_Parent = nullptr;
+		uint64_t m_Generation = 0;
+
+		llvm::Function *m_Global = nullptr;
+		const FunctionInfo *m_Function = nullptr;
+
+		// type lowering cache of builders that run next to others and must not touch Type::IR
+		std::unordered_map<const Type *, llvm::Type *> m_IRTypes;
+
+		std::unordered_map<Name, FunctionInfo> m_Functions;
+
+		// the position of every function and global in declaration order, shared with child builders
+		std::unordered_map<Name, size_t> m_Declared;
+		size_t m_DeclarationLimit = std::numeric_limits<size_t>::max();
 
-		std::map<llvm::Function *, FunctionInfo> m_FunctionInfos;
+		struct Shadowed
+		{
+			Name MName;
+			ValuePtr Previous;
+		};
 
-		std::vector<std::map<std::string, ValuePtr>> m_Stack;
-		std::map<std::string, ValuePtr> m_Variables;
+		// bindings replaced inside the open scopes, undone in reverse on Pop
+		std::unordered_map<Name, ValuePtr> m_Variables;
+		std::vector<Shadowed> m_Undo;
+		std::vector<size_t> m_Scopes;
 	};
 }
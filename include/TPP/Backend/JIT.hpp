@@ -0,0 +1,24 @@
+#pragma once
+
+#include <TPP/Backend/Optimizer.hpp>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tpp
+{
+	class JIT
+	{
+	public:
+		explicit JIT(OptLevel level);
+
+		void Add(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module);
+		int Run(const std::string &program, const std::vector<std::string> &args);
+
+	private:
+		std::unique_ptr<llvm::orc::LLJIT> m_JIT;
+	};
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <TPP/Backend/Optimizer.hpp>
+#include <TPP/Frontend/DependencyGraph.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace tpp
+{
+	class ObjectCache
+	{
+	public:
+		ObjectCache(const std::filesystem::path &directory, const DependencyGraph &graph, OptLevel level, const std::string &passes, const llvm::Module &module);
+
+		// the lowered function bodies of one source file, valid while the file and the interfaces visible to it are unchanged
+		std::unique_ptr<llvm::MemoryBuffer> Load(const std::string &filepath);
+		void Store(const std::string &filepath, llvm::StringRef bitcode);
+
+	private:
+		std::filesystem::path EntryPath(const std::string &filepath);
+		uint64_t Key(const std::string &filepath);
+
+		std::filesystem::path m_Directory;
+		const DependencyGraph &m_Graph;
+		std::string m_Options;
+
+		std::mutex m_Mutex;
+		std::unordered_map<std::string, uint64_t> m_Keys;
+	};
+}
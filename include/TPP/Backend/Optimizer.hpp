@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <llvm/Analysis/CGSCCPassManager.h>
+#include <llvm/Analysis/LoopAnalysisManager.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tpp
+{
+	enum OptLevel
+	{
+		OptLevel_O0,
+		OptLevel_O1,
+		OptLevel_O2,
+		OptLevel_O3,
+	};
+
+	// the backend level matching an optimization level, shared by static compilation and the jit
+	llvm::CodeGenOpt::Level GetCodeGenLevel(OptLevel level);
+
+	class Optimizer
+	{
+	public:
+		Optimizer(OptLevel level, const std::string &passes = {}, llvm::TargetMachine *machine = nullptr);
+
+		OptLevel Level() const;
+
+		void Run(llvm::Function &function);
+		void Run(llvm::Module &module);
+
+	private:
+		void BeginPass(llvm::StringRef pass);
+		void EndPass(llvm::StringRef pass);
+
+		OptLevel m_Level;
+		std::string m_Passes;
+
+		// running passes, innermost last; each one is charged only for the time no nested pass runs
+		llvm::PassInstrumentationCallbacks m_PIC;
+		std::vector<std::pair<llvm::StringRef, std::chrono::steady_clock::time_point>> m_Running;
+
+		llvm::LoopAnalysisManager m_LAM;
+		llvm::FunctionAnalysisManager m_FAM;
+		llvm::CGSCCAnalysisManager m_CGAM;
+		llvm::ModuleAnalysisManager m_MAM;
+		llvm::PassBuilder m_PB;
+
+		llvm::FunctionPassManager m_FPM;
+		llvm::ModulePassManager m_MPM;
+	};
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <TPP/Backend/Builder.hpp>
+#include <TPP/Backend/ObjectCache.hpp>
+#include <TPP/Backend/Optimizer.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Name.hpp>
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace tpp
+{
+	// a function body and how many declarations were visible where it was defined
+	struct DeferredBody
+	{
+		ExprPtr Body;
+		size_t Declarations;
+	};
+
+	class ParallelBuilder
+	{
+	public:
+		// with an object cache, bodies are lowered per source file and unchanged files are loaded instead
+		ParallelBuilder(Builder &builder, OptLevel level, const std::string &passes, unsigned jobs, ObjectCache *cache = nullptr);
+
+		void GenIR(const ExprPtr &ptr);
+		void Finish();
+
+	private:
+		Builder &m_Builder;
+		OptLevel m_Level;
+		std::string m_Passes;
+		unsigned m_Jobs;
+		ObjectCache *m_Cache;
+
+		std::vector<DeferredBody> m_Bodies;
+		std::unordered_set<Name> m_Defined;
+	};
+}
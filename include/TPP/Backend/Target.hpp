@@ -0,0 +1,29 @@
+#pragma once
+
+#include <TPP/Backend/Optimizer.hpp>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tpp
+{
+	class Target
+	{
+	public:
+		static void Init();
+		static void Link(const std::vector<std::string> &objects, const std::string &filename);
+
+		explicit Target(OptLevel level);
+
+		llvm::TargetMachine &Machine() const;
+
+		void Configure(llvm::Module &module) const;
+		void Emit(llvm::Module &module, const std::string &filename, llvm::CodeGenFileType type) const;
+
+	private:
+		std::unique_ptr<llvm::TargetMachine> m_Machine;
+	};
+}
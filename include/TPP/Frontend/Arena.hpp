@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tpp
+{
+	class Arena
+	{
+	public:
+		Arena();
+		Arena(Arena &&other) noexcept;
+		Arena &operator=(Arena &&other) noexcept;
+		~Arena();
+
+		Arena(const Arena &) = delete;
+		Arena &operator=(const Arena &) = delete;
+
+		template <typename T, typename... Args>
+		T *New(Args &&...args)
+		{
+			auto ptr = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+			if constexpr (!std::is_trivially_destructible_v<T>) m_Destructors.push_back({ ptr, [](void *p) { static_cast<T *>(p)->~T(); } });
+			return ptr;
+		}
+
+		void *Allocate(size_t size, size_t align);
+		void Reset();
+
+		// takes over everything allocated in other, released on the next Reset
+		void Adopt(Arena &&other);
+
+		size_t Used() const;
+
+	private:
+		struct Destructor
+		{
+			void *Ptr;
+			void (*Destroy)(void *);
+		};
+
+		std::vector<std::unique_ptr<char[]>> m_Blocks;
+		std::vector<size_t> m_Sizes;
+		size_t m_Block = 0;
+		char *m_Ptr = nullptr;
+		char *m_End = nullptr;
+		size_t m_Used = 0;
+
+		std::vector<Destructor> m_Destructors;
+		std::vector<Arena> m_Adopted;
+	};
+}
@@ -1,15 +1,16 @@
 #pragma once
 
 #include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Symbol.hpp>
 
 namespace tpp
 {
 	struct Arg
 	{
-		Arg(const TypePtr &type, const std::string &name);
+		Arg(const TypePtr &type, Symbol name);
 
 		TypePtr Type;
-		std::string Name;
+		Symbol Name;
 	};
 
 	std::ostream &operator<<(std::ostream &out, const Arg &arg);
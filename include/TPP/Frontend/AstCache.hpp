@@ -0,0 +1,130 @@
+#pragma once
+
+#include <TPP/Frontend/Arena.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/LoopHints.hpp>
+#include <TPP/Frontend/Name.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <TPP/Frontend/StructElement.hpp>
+#include <TPP/Frontend/Symbol.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <llvm/Support/MemoryBuffer.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tpp
+{
+	enum AstItemKind
+	{
+		AstItemKind_End,
+		AstItemKind_Expr,
+		AstItemKind_Struct,
+		AstItemKind_Include,
+	};
+
+	struct AstItem
+	{
+		AstItemKind Kind = AstItemKind_End;
+		ExprPtr Expr = nullptr;
+		Symbol Name;
+		std::vector<StructElement> Elements;
+		std::filesystem::path Include;
+	};
+
+	class AstWriter
+	{
+	public:
+		// an interface writer keeps only what other files can see: signatures, globals and structs
+		explicit AstWriter(bool interface = false);
+
+		void Expr(const ExprPtr &ptr);
+		void Struct(Symbol name, const std::vector<StructElement> &elements);
+		void Include(const std::filesystem::path &filepath);
+
+		const std::vector<std::string> &Includes() const;
+		uint64_t Hash() const;
+
+	private:
+		friend class AstCache;
+
+		void Write(uint64_t value);
+		void Write(std::string_view value);
+		void Write(Symbol symbol);
+		void Write(const Name &name);
+		void Write(const TypePtr &type);
+		void Write(const LoopHints &hints);
+		void Write(const ExprPtr &ptr);
+
+		std::string m_Items;
+		std::unordered_map<Symbol, uint32_t> m_Symbols;
+		std::vector<Symbol> m_SymbolList;
+		std::vector<std::string> m_Includes;
+		bool m_Interface;
+	};
+
+	class AstReader
+	{
+	public:
+		// types are resolved right away, or deferred like a concurrently parsed file
+		bool Next(AstItem &item, Arena &exprs, Arena &structs, bool deferred);
+
+	private:
+		friend class AstCache;
+
+		uint64_t Read();
+		std::string_view ReadString();
+		Symbol ReadSymbol();
+		Name ReadName();
+		TypePtr ReadType();
+		LoopHints ReadHints();
+		ExprPtr ReadExpr(Arena &arena);
+
+		std::unique_ptr<llvm::MemoryBuffer> m_Buffer;
+		const std::filesystem::path *m_Filepath = nullptr;
+		const char *m_Ptr = nullptr;
+		const char *m_End = nullptr;
+		std::vector<Symbol> m_Symbols;
+		bool m_Deferred = false;
+	};
+
+	class AstCache
+	{
+	public:
+		explicit AstCache(const std::filesystem::path &directory);
+
+		std::unique_ptr<AstReader> Open(const std::filesystem::path &filepath);
+
+		// entries are written by Flush, once the include lists of the whole graph are known
+		void Store(const std::filesystem::path &filepath, AstWriter &&writer);
+		void Flush();
+
+	private:
+		struct Header
+		{
+			uint64_t Content;
+			uint64_t Key;
+			uint64_t Checksum;
+			std::vector<std::string> Includes;
+		};
+
+		std::filesystem::path EntryPath(const std::string &filepath) const;
+		static bool ReadHeader(AstReader &reader, Header &header);
+
+		uint64_t ContentHash(const std::string &filepath);
+		bool GetIncludes(const std::string &filepath, std::vector<std::string> &includes);
+		uint64_t Key(const std::string &filepath);
+
+		void Write(const std::string &filepath, const AstWriter &writer);
+
+		std::filesystem::path m_Directory;
+
+		std::mutex m_Mutex;
+		std::unordered_map<std::string, uint64_t> m_Hashes;
+		std::unordered_map<std::string, std::vector<std::string>> m_Includes;
+		std::vector<std::pair<std::string, AstWriter>> m_Pending;
+	};
+}
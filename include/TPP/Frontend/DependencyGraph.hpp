@@ -0,0 +1,32 @@
+#pragma once
+
+#include <TPP/Frontend/AstCache.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tpp
+{
+	class DependencyGraph
+	{
+	public:
+		// the returned writer records the includes and interface of the file while it is parsed
+		AstWriter &Add(const std::filesystem::path &filepath);
+		// records that the file's items start reaching the builder, so everything delivered before stays visible to it without an include
+		void Deliver(const std::filesystem::path &filepath);
+
+		std::vector<std::string> Closure(const std::string &filepath) const;
+		// the files whose declarations the file can see: those delivered before it, then its include closure
+		std::vector<std::string> Visible(const std::string &filepath) const;
+		uint64_t Interface(const std::string &filepath) const;
+
+	private:
+		mutable std::mutex m_Mutex;
+		std::unordered_map<std::string, std::unique_ptr<AstWriter>> m_Files;
+		std::vector<std::string> m_Order;
+	};
+}
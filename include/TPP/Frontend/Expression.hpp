@@ -2,25 +2,68 @@
 
 #include <TPP/Frontend/Arg.hpp>
 #include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/LoopHints.hpp>
 #include <TPP/Frontend/Name.hpp>
+#include <TPP/Frontend/Operator.hpp>
 #include <TPP/Frontend/SourceLocation.hpp>
+#include <TPP/Frontend/Symbol.hpp>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace tpp
 {
-	struct Expression : std::enable_shared_from_this<Expression>
+	enum ExpressionKind
 	{
-		explicit Expression(const SourceLocation &location);
+		ExpressionKind_DefFunction,
+		ExpressionKind_DefVariable,
+		ExpressionKind_Return,
+		ExpressionKind_For,
+		ExpressionKind_While,
+		ExpressionKind_If,
+		ExpressionKind_Group,
+		ExpressionKind_Binary,
+		ExpressionKind_Call,
+		ExpressionKind_Index,
+		ExpressionKind_Member,
+		ExpressionKind_ID,
+		ExpressionKind_Number,
+		ExpressionKind_Char,
+		ExpressionKind_String,
+		ExpressionKind_VarArgs,
+		ExpressionKind_Unary,
+		ExpressionKind_Object,
+		ExpressionKind_Array,
+		ExpressionKind_Sync,
+	};
+
+	struct Expression
+	{
+		Expression(ExpressionKind kind, const SourceLocation &location);
 		virtual ~Expression();
 
 		virtual TypePtr GetType() const = 0;
 
+		template <typename T>
+		T *As()
+		{
+			return Kind == T::KIND ? static_cast<T *>(this) : nullptr;
+		}
+
+		template <typename T>
+		const T *As() const
+		{
+			return Kind == T::KIND ? static_cast<const T *>(this) : nullptr;
+		}
+
+		ExpressionKind Kind;
 		SourceLocation Location;
 	};
 
 	struct DefFunctionExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_DefFunction;
+
 		DefFunctionExpression(const SourceLocation &location, const TypePtr &result, const Name &name, const std::vector<Arg> &args, bool is_var_arg, const ExprPtr &body);
 
 		TypePtr GetType() const override;
@@ -34,6 +77,8 @@ namespace tpp
 
 	struct DefVariableExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_DefVariable;
+
 		DefVariableExpression(const SourceLocation &location, const TypePtr &type, const Name &name, const ExprPtr &size, const ExprPtr &init);
 
 		TypePtr GetType() const override;
@@ -46,6 +91,8 @@ namespace tpp
 
 	struct ReturnExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Return;
+
 		ReturnExpression(const SourceLocation &location, const ExprPtr &result);
 
 		TypePtr GetType() const override;
@@ -55,29 +102,39 @@ namespace tpp
 
 	struct ForExpression : Expression
 	{
-		ForExpression(const SourceLocation &location, const ExprPtr &from, const ExprPtr &to, const ExprPtr &step, const std::string &id, const ExprPtr &body);
+		static constexpr ExpressionKind KIND = ExpressionKind_For;
+
+		ForExpression(const SourceLocation &location, bool is_parallel, const ExprPtr &from, const ExprPtr &to, const ExprPtr &step, Symbol id, const LoopHints &hints, const ExprPtr &body);
 
 		TypePtr GetType() const override;
 
+		// 'pfor' runs its iterations concurrently on the runtime's worker pool
+		bool IsParallel;
 		ExprPtr From;
 		ExprPtr To;
 		ExprPtr Step;
-		std::string Id;
+		Symbol Id;
+		LoopHints Hints;
 		ExprPtr Body;
 	};
 
 	struct WhileExpression : Expression
 	{
-		WhileExpression(const SourceLocation &location, const ExprPtr &condition, const ExprPtr &body);
+		static constexpr ExpressionKind KIND = ExpressionKind_While;
+
+		WhileExpression(const SourceLocation &location, const ExprPtr &condition, const LoopHints &hints, const ExprPtr &body);
 
 		TypePtr GetType() const override;
 
 		ExprPtr Condition;
+		LoopHints Hints;
 		ExprPtr Body;
 	};
 
 	struct IfExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_If;
+
 		IfExpression(const SourceLocation &location, const ExprPtr &condition, const ExprPtr &branchTrue, const ExprPtr &branchFalse);
 
 		TypePtr GetType() const override;
@@ -89,6 +146,8 @@ namespace tpp
 
 	struct GroupExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Group;
+
 		GroupExpression(const SourceLocation &location, const std::vector<ExprPtr> &body);
 
 		TypePtr GetType() const override;
@@ -98,27 +157,35 @@ namespace tpp
 
 	struct BinaryExpression : Expression
 	{
-		BinaryExpression(const SourceLocation &location, const std::string &op, const ExprPtr &lhs, const ExprPtr &rhs);
+		static constexpr ExpressionKind KIND = ExpressionKind_Binary;
+
+		BinaryExpression(const SourceLocation &location, BinaryOp op, const ExprPtr &lhs, const ExprPtr &rhs);
 
 		TypePtr GetType() const override;
 
-		std::string Operator;
+		BinaryOp Operator;
 		ExprPtr Lhs;
 		ExprPtr Rhs;
 	};
 
 	struct CallExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Call;
+
 		CallExpression(const SourceLocation &location, const Name &callee, const std::vector<ExprPtr> &args);
 
 		TypePtr GetType() const override;
 
 		Name Callee;
 		std::vector<ExprPtr> Args;
+		// 'spawn' runs the call as a task and yields a future for its result instead
+		bool IsSpawn = false;
 	};
 
 	struct IndexExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Index;
+
 		IndexExpression(const SourceLocation &location, const ExprPtr &array, const ExprPtr &index);
 
 		TypePtr GetType() const override;
@@ -129,16 +196,20 @@ namespace tpp
 
 	struct MemberExpression : Expression
 	{
-		MemberExpression(const SourceLocation &location, const ExprPtr &object, const std::string &member);
+		static constexpr ExpressionKind KIND = ExpressionKind_Member;
+
+		MemberExpression(const SourceLocation &location, const ExprPtr &object, Symbol member);
 
 		TypePtr GetType() const override;
 
 		ExprPtr Object;
-		std::string Member;
+		Symbol Member;
 	};
 
 	struct IDExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_ID;
+
 		IDExpression(const SourceLocation &location, const Name &name);
 
 		TypePtr GetType() const override;
@@ -148,16 +219,29 @@ namespace tpp
 
 	struct NumberExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Number;
+
 		NumberExpression(const SourceLocation &location, const std::string &value);
+		// a constant as left by folding or loaded from the ast cache; integers are sign-extended from their width
+		NumberExpression(const SourceLocation &location, const TypePtr &type, bool is_integer, int64_t integer, double value);
 
 		TypePtr GetType() const override;
+		// unsuffixed literals take the number type of their context, as long as they fit
+		TypePtr GetType(const TypePtr &context) const;
 
-		double Value;
+		// null for unsuffixed literals
+		TypePtr Type;
+		bool IsInteger = false;
+		int64_t Integer = 0;
+		double Value = 0;
 	};
 
 	struct CharExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Char;
+
 		CharExpression(const SourceLocation &location, const std::string &value);
+		CharExpression(const SourceLocation &location, char value);
 
 		TypePtr GetType() const override;
 
@@ -166,6 +250,8 @@ namespace tpp
 
 	struct StringExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_String;
+
 		StringExpression(const SourceLocation &location, const std::string &value);
 
 		TypePtr GetType() const override;
@@ -175,6 +261,8 @@ namespace tpp
 
 	struct VarArgsExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_VarArgs;
+
 		explicit VarArgsExpression(const SourceLocation &location);
 
 		TypePtr GetType() const override;
@@ -182,6 +270,8 @@ namespace tpp
 
 	struct UnaryExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Unary;
+
 		UnaryExpression(const SourceLocation &location, const std::string &op, const ExprPtr &operand);
 
 		TypePtr GetType() const override;
@@ -192,6 +282,8 @@ namespace tpp
 
 	struct ObjectExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Object;
+
 		ObjectExpression(const SourceLocation &location, const std::vector<ExprPtr> &init);
 
 		TypePtr GetType() const override;
@@ -201,6 +293,8 @@ namespace tpp
 
 	struct ArrayExpression : Expression
 	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Array;
+
 		ArrayExpression(const SourceLocation &location, const ExprPtr &size, const ExprPtr &init);
 
 		TypePtr GetType() const override;
@@ -209,6 +303,17 @@ namespace tpp
 		ExprPtr Init;
 	};
 
+	struct SyncExpression : Expression
+	{
+		static constexpr ExpressionKind KIND = ExpressionKind_Sync;
+
+		SyncExpression(const SourceLocation &location, const ExprPtr &future);
+
+		TypePtr GetType() const override;
+
+		ExprPtr Future;
+	};
+
 	std::ostream &operator<<(std::ostream &out, const DefFunctionExpression &e);
 	std::ostream &operator<<(std::ostream &out, const DefVariableExpression &e);
 	std::ostream &operator<<(std::ostream &out, const ReturnExpression &e);
@@ -228,4 +333,34 @@ namespace tpp
 	std::ostream &operator<<(std::ostream &out, const UnaryExpression &e);
 	std::ostream &operator<<(std::ostream &out, const ObjectExpression &e);
 	std::ostream &operator<<(std::ostream &out, const ArrayExpression &e);
+	std::ostream &operator<<(std::ostream &out, const SyncExpression &e);
+
+	template <typename V>
+	decltype(auto) Visit(const Expression &e, V &&visitor)
+	{
+		switch (e.Kind)
+		{
+		case ExpressionKind_DefFunction: return visitor(static_cast<const DefFunctionExpression &>(e));
+		case ExpressionKind_DefVariable: return visitor(static_cast<const DefVariableExpression &>(e));
+		case ExpressionKind_Return: return visitor(static_cast<const ReturnExpression &>(e));
+		case ExpressionKind_For: return visitor(static_cast<const ForExpression &>(e));
+		case ExpressionKind_While: return visitor(static_cast<const WhileExpression &>(e));
+		case ExpressionKind_If: return visitor(static_cast<const IfExpression &>(e));
+		case ExpressionKind_Group: return visitor(static_cast<const GroupExpression &>(e));
+		case ExpressionKind_Binary: return visitor(static_cast<const BinaryExpression &>(e));
+		case ExpressionKind_Call: return visitor(static_cast<const CallExpression &>(e));
+		case ExpressionKind_Index: return visitor(static_cast<const IndexExpression &>(e));
+		case ExpressionKind_Member: return visitor(static_cast<const MemberExpression &>(e));
+		case ExpressionKind_ID: return visitor(static_cast<const IDExpression &>(e));
+		case ExpressionKind_Number: return visitor(static_cast<const NumberExpression &>(e));
+		case ExpressionKind_Char: return visitor(static_cast<const CharExpression &>(e));
+		case ExpressionKind_String: return visitor(static_cast<const StringExpression &>(e));
+		case ExpressionKind_VarArgs: return visitor(static_cast<const VarArgsExpression &>(e));
+		case ExpressionKind_Unary: return visitor(static_cast<const UnaryExpression &>(e));
+		case ExpressionKind_Object: return visitor(static_cast<const ObjectExpression &>(e));
+		case ExpressionKind_Array: return visitor(static_cast<const ArrayExpression &>(e));
+		case ExpressionKind_Sync: return visitor(static_cast<const SyncExpression &>(e));
+		default: error(e.Location, "missing switch case");
+		}
+	}
 }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <TPP/Frontend/Arena.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Name.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace tpp
+{
+	struct BinaryExpression;
+	struct NumberExpression;
+
+	// folds constant arithmetic, comparisons and casts of top-level expressions in place before they are lowered;
+	// globals with a constant value are propagated into the global initializers that run after them
+	class Folder
+	{
+	public:
+		ExprPtr Fold(const ExprPtr &ptr);
+
+	private:
+		ExprPtr FoldExpr(const ExprPtr &ptr);
+		ExprPtr FoldBinary(BinaryExpression &e);
+
+		NumberExpression *GetConstant(const ExprPtr &ptr);
+		NumberExpression *Cast(NumberExpression *value, const TypePtr &type);
+		NumberExpression *Evaluate(const BinaryExpression &e, NumberExpression *lhs, NumberExpression *rhs);
+
+		NumberExpression *New(const SourceLocation &location, const TypePtr &type, int64_t integer, double value);
+
+		// whatever ran in a global initializer may have changed any global
+		void Invalidate();
+
+		Arena m_Arena;
+		ExprPtr m_TopLevel = nullptr;
+		bool m_InFunction = false;
+
+		std::unordered_map<Name, NumberExpression *> m_Globals;
+		std::vector<Name> m_Locals;
+	};
+}
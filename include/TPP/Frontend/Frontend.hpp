@@ -3,9 +3,15 @@
 #include <iostream>
 #include <memory>
 
+namespace llvm
+{
+	class Type;
+}
+
 namespace tpp
 {
 	class Parser;
+	class Arena;
 
 	struct SourceLocation;
 	struct Name;
@@ -17,10 +23,11 @@ namespace tpp
 
 	struct Type;
 	struct ArrayType;
+	class TypeContext;
 
 	typedef std::shared_ptr<Type> TypePtr;
 	typedef std::shared_ptr<ArrayType> ArrayTypePtr;
-	typedef std::shared_ptr<Expression> ExprPtr;
+	typedef Expression *ExprPtr;
 
 	std::ostream &operator<<(std::ostream &out, const ExprPtr &ptr);
 
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <ostream>
+
+namespace tpp
+{
+	// '@vectorize(width)' and '@unroll(count)' after a loop header; without a count llvm picks one, a count of 1 disables the transform
+	struct LoopHints
+	{
+		bool Vectorize = false;
+		unsigned VectorizeWidth = 0;
+		bool Unroll = false;
+		unsigned UnrollCount = 0;
+	};
+
+	std::ostream &operator<<(std::ostream &out, const LoopHints &hints);
+}
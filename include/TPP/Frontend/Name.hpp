@@ -1,7 +1,10 @@
 #pragma once
 
+#include <TPP/Frontend/Symbol.hpp>
 #include <iostream>
+#include <llvm/ADT/SmallVector.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace tpp
@@ -10,22 +13,33 @@ namespace tpp
 	{
 		Name();
 		Name(const char *name);
+		Name(std::string_view name);
 		Name(const std::string &name);
-		Name(const std::vector<std::string> &path);
-		Name(const std::vector<std::string> &ns, const std::string &name);
-		Name(const Name &ns, const std::string &name);
-		Name(const std::vector<std::string> &ns, const Name &name);
+		Name(Symbol name);
+		Name(const Name &ns, Symbol name);
+		Name(const std::vector<Symbol> &ns, const Name &name);
+
+		void Append(Symbol symbol);
 
 		std::string String() const;
-		std::vector<std::string> Namespace();
-		std::string Head();
+		Name Namespace() const;
+		Symbol Head() const;
 
 		bool operator!() const;
 
-		std::vector<std::string> Path;
+		llvm::SmallVector<Symbol, 2> Path;
+		size_t Hash = 0;
 	};
 
+	bool operator==(const Name &a, const Name &b);
+	bool operator!=(const Name &a, const Name &b);
 	bool operator<(const Name &a, const Name &b);
 
 	std::ostream &operator<<(std::ostream &out, const Name &name);
 }
+
+template <>
+struct std::hash<tpp::Name>
+{
+	size_t operator()(const tpp::Name &name) const noexcept { return name.Hash; }
+};
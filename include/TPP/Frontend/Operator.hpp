@@ -0,0 +1,74 @@
+#pragma once
+
+#include <iterator>
+#include <string_view>
+
+namespace tpp
+{
+	enum BinaryOp
+	{
+		BinaryOp_,
+		BinaryOp_Assign,
+		BinaryOp_ShlAssign,
+		BinaryOp_AShrAssign,
+		BinaryOp_LShrAssign,
+		BinaryOp_AddAssign,
+		BinaryOp_SubAssign,
+		BinaryOp_MulAssign,
+		BinaryOp_DivAssign,
+		BinaryOp_RemAssign,
+		BinaryOp_AndAssign,
+		BinaryOp_OrAssign,
+		BinaryOp_XorAssign,
+		BinaryOp_LAnd,
+		BinaryOp_LOr,
+		BinaryOp_LT,
+		BinaryOp_GT,
+		BinaryOp_LE,
+		BinaryOp_GE,
+		BinaryOp_EQ,
+		BinaryOp_NE,
+		BinaryOp_And,
+		BinaryOp_Or,
+		BinaryOp_Xor,
+		BinaryOp_Shl,
+		BinaryOp_AShr,
+		BinaryOp_LShr,
+		BinaryOp_Add,
+		BinaryOp_Sub,
+		BinaryOp_Mul,
+		BinaryOp_Div,
+		BinaryOp_Rem,
+	};
+
+	struct BinaryOpInfo
+	{
+		std::string_view Text;
+		unsigned Precedence;
+		bool RightAssoc;
+		BinaryOp Base; // the arithmetic part of a compound assignment
+	};
+
+	inline constexpr BinaryOpInfo BINARY_OPS[] = {
+		{ "", 0, false, BinaryOp_ },		  { "=", 0, true, BinaryOp_ },		  { "<<=", 0, true, BinaryOp_Shl }, { ">>=", 0, true, BinaryOp_AShr },
+		{ ">>>=", 0, true, BinaryOp_LShr },	  { "+=", 0, true, BinaryOp_Add },	  { "-=", 0, true, BinaryOp_Sub },	{ "*=", 0, true, BinaryOp_Mul },
+		{ "/=", 0, true, BinaryOp_Div },	  { "%=", 0, true, BinaryOp_Rem },	  { "&=", 0, true, BinaryOp_And },	{ "|=", 0, true, BinaryOp_Or },
+		{ "^=", 0, true, BinaryOp_Xor },	  { "&&", 1, false, BinaryOp_ },	  { "||", 1, false, BinaryOp_ },	{ "<", 2, false, BinaryOp_ },
+		{ ">", 2, false, BinaryOp_ },		  { "<=", 2, false, BinaryOp_ },	  { ">=", 2, false, BinaryOp_ },	{ "==", 2, false, BinaryOp_ },
+		{ "!=", 2, false, BinaryOp_ },		  { "&", 3, false, BinaryOp_ },		  { "|", 3, false, BinaryOp_ },		{ "^", 3, false, BinaryOp_ },
+		{ "<<", 4, false, BinaryOp_ },		  { ">>", 4, false, BinaryOp_ },	  { ">>>", 4, false, BinaryOp_ },	{ "+", 5, false, BinaryOp_ },
+		{ "-", 5, false, BinaryOp_ },		  { "*", 6, false, BinaryOp_ },		  { "/", 6, false, BinaryOp_ },		{ "%", 6, false, BinaryOp_ },
+	};
+
+	static_assert(std::size(BINARY_OPS) == BinaryOp_Rem + 1);
+	static_assert(BINARY_OPS[BinaryOp_XorAssign].Text == "^=" && BINARY_OPS[BinaryOp_NE].Text == "!=" && BINARY_OPS[BinaryOp_Rem].Text == "%");
+
+	constexpr const BinaryOpInfo &GetInfo(BinaryOp op) { return BINARY_OPS[op]; }
+
+	constexpr BinaryOp ToBinaryOp(std::string_view text)
+	{
+		for (size_t i = 1; i < std::size(BINARY_OPS); ++i)
+			if (BINARY_OPS[i].Text == text) return (BinaryOp) i;
+		return BinaryOp_;
+	}
+}
@@ -1,56 +1,71 @@
 #pragma once
 
+#include <TPP/Frontend/Arena.hpp>
 #include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/LoopHints.hpp>
 #include <TPP/Frontend/Name.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
 #include <TPP/Frontend/Token.hpp>
 #include <filesystem>
 #include <functional>
 #include <iostream>
-#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 namespace tpp
 {
 	typedef std::function<void(const ExprPtr &)> TPPCallback;
 
-	enum ParserMode
-	{
-		ParserMode_,
-		ParserMode_Normal,
-		ParserMode_Comment,
-		ParserMode_Number,
-		ParserMode_Id,
-		ParserMode_BinaryOperator,
-		ParserMode_String,
-		ParserMode_Char,
-	};
+	class AstCache;
+	class AstWriter;
+	class DependencyGraph;
+
+	struct ParseItem;
+	struct ParseUnit;
+	struct ParseSession;
 
 	class Parser
 	{
 	private:
-		static void ParseFile(const std::filesystem::path &filepath, std::vector<std::filesystem::path> &parsed, const TPPCallback &callback);
+		static void ParseFile(const std::filesystem::path &filepath, std::unordered_set<std::string> &parsed, Arena *arena, const TPPCallback &callback, AstCache *cache, DependencyGraph *graph);
+		static void ParseFile(const std::filesystem::path &filepath, Arena *arena, const TPPCallback &callback, unsigned jobs, AstCache *cache, DependencyGraph *graph);
+		static void ParseFile(ParseSession &session, ParseUnit &unit);
+
+		static ParseUnit *Enqueue(ParseSession &session, const std::filesystem::path &filepath);
+		static void Deliver(ParseSession &session, ParseUnit &unit, Arena *arena, const TPPCallback &callback);
 
 	public:
-		static void ParseFile(const std::filesystem::path &filepath, const TPPCallback &callback);
+		static void ParseFile(const std::filesystem::path &filepath, const TPPCallback &callback, unsigned jobs = 1, AstCache *cache = nullptr, DependencyGraph *graph = nullptr);
+		static void ParseFile(const std::filesystem::path &filepath, Arena &arena, const TPPCallback &callback, unsigned jobs = 1, AstCache *cache = nullptr, DependencyGraph *graph = nullptr);
+
+		// runs only the lexer over source, for benchmarking
+		static size_t CountTokens(std::string_view source, const std::filesystem::path &filepath);
 
 	private:
-		Parser(std::istream &stream, const std::filesystem::path &filepath, std::vector<std::filesystem::path> &parsed, const TPPCallback &callback);
+		Parser(std::string_view source, const std::filesystem::path &filepath, Arena *arena);
 
 		ExprPtr GetNext();
 
-		int Get();
-		void Escape();
-		void NewLine();
+		void NewLine(const char *line_start);
+		void SkipSpace();
 		Token &Next();
 
+		SourceLocation Location() const;
+
 		bool AtEOF();
 		bool At(const TokenType type);
-		bool At(const std::string &value);
+		bool At(std::string_view value);
+		bool At(Keyword keyword);
 
 		bool NextIfAt(const TokenType type);
-		bool NextIfAt(const std::string &value);
+		bool NextIfAt(std::string_view value);
+		bool NextIfAt(Keyword keyword);
 
 		Token Expect(const TokenType type);
-		void Expect(const std::string &value);
+		void Expect(std::string_view value);
+		void Expect(Keyword keyword);
 
 		Token Skip();
 
@@ -66,6 +81,7 @@ namespace tpp
 		ExprPtr ParseReturn();
 		ExprPtr ParseFor();
 		ExprPtr ParseWhile();
+		LoopHints ParseLoopHints();
 		ExprPtr ParseIf();
 		ExprPtr ParseGroup();
 		ExprPtr ParseBinary();
@@ -77,18 +93,32 @@ namespace tpp
 		ExprPtr ParsePrimary();
 
 	private:
-		static std::map<std::string, unsigned> PRECEDENCES;
+		static std::string Unescape(std::string_view value);
 
 	private:
-		std::filesystem::path m_Filepath;
-		std::vector<std::filesystem::path> &m_Parsed;
-		TPPCallback m_Callback;
+		const std::filesystem::path *m_Filepath;
+
+		// either streaming to a callback, or collecting into a unit of a concurrent session
+		std::unordered_set<std::string> *m_Parsed = nullptr;
+		const TPPCallback *m_Callback = nullptr;
+		ParseSession *m_Session = nullptr;
+		ParseUnit *m_Unit = nullptr;
+
+		// records what was parsed for the ast cache, and the includes and interface for the dependency graph
+		AstCache *m_Cache = nullptr;
+		AstWriter *m_Writer = nullptr;
+		DependencyGraph *m_Graph = nullptr;
+		AstWriter *m_Interface = nullptr;
+
+		Arena m_ExprArena;
+		Arena *m_Arena;
 
-		std::istream &m_Stream;
-		SourceLocation m_Location;
-		int chr = -1;
+		const char *m_Ptr;
+		const char *m_End;
+		const char *m_LineStart;
+		size_t m_Row = 1;
 
-		std::vector<std::string> m_Namespace;
+		std::vector<Symbol> m_Namespace;
 		bool m_InFunction = false;
 		Token m_Token;
 	};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <llvm/ADT/STLFunctionalExtras.h>
+#include <llvm/Support/raw_ostream.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace tpp
+{
+	enum ProfilePhase
+	{
+		ProfilePhase_ParseFile,
+		ProfilePhase_Lex,
+		ProfilePhase_Parse,
+		ProfilePhase_TypeLookup,
+		ProfilePhase_Fold,
+		ProfilePhase_GenIR,
+		ProfilePhase_GenFunction,
+		ProfilePhase_Verify,
+		ProfilePhase_OptimizeFunction,
+		ProfilePhase_Optimize,
+		ProfilePhase_Link,
+		ProfilePhase_Emit,
+		ProfilePhase_JIT,
+		ProfilePhase_Count,
+	};
+
+	// collects the --time-report table and drives llvm's time trace profiler for -ftime-trace
+	class Profiler
+	{
+	public:
+		static Profiler &Global();
+
+		void EnableReport();
+		void EnableTrace(unsigned granularity);
+
+		bool Report() const;
+		bool Trace() const;
+		unsigned Granularity() const;
+
+		void Add(ProfilePhase phase, std::chrono::steady_clock::duration duration);
+		void AddPass(std::string_view name, std::chrono::steady_clock::duration duration, uint64_t runs);
+
+		void PrintReport(llvm::raw_ostream &out) const;
+		void WriteTrace(const std::string &filename);
+
+	private:
+		std::atomic<bool> m_Report = false;
+		std::atomic<bool> m_Trace = false;
+		unsigned m_Granularity = 0;
+		std::chrono::steady_clock::time_point m_Begin;
+
+		std::atomic<int64_t> m_Nanoseconds[ProfilePhase_Count]{};
+		std::atomic<uint64_t> m_Counts[ProfilePhase_Count]{};
+
+		mutable std::mutex m_Mutex;
+		std::map<std::string, std::pair<int64_t, uint64_t>, std::less<>> m_Passes;
+	};
+
+	// times a phase for the report; traced phases also get a trace event, with an optional detail like a function name
+	class ProfileScope
+	{
+	public:
+		explicit ProfileScope(ProfilePhase phase, bool trace = true);
+		ProfileScope(ProfilePhase phase, llvm::function_ref<std::string()> detail);
+		~ProfileScope();
+
+		ProfileScope(const ProfileScope &) = delete;
+		ProfileScope &operator=(const ProfileScope &) = delete;
+
+	private:
+		ProfilePhase m_Phase;
+		bool m_Report;
+		bool m_Trace;
+		std::chrono::steady_clock::time_point m_Begin;
+	};
+
+	// gives a worker thread its own trace profiler for as long as it lives
+	class ProfileThread
+	{
+	public:
+		ProfileThread();
+		~ProfileThread();
+
+		ProfileThread(const ProfileThread &) = delete;
+		ProfileThread &operator=(const ProfileThread &) = delete;
+
+	private:
+		bool m_Owner = false;
+	};
+}
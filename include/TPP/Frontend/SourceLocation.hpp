@@ -8,7 +8,10 @@ namespace tpp
 	{
 		static const SourceLocation UNKNOWN;
 
-		std::filesystem::path Filepath{};
+		// one shared copy per distinct path that lives as long as the program, so locations stay trivially destructible
+		static const std::filesystem::path *Intern(const std::filesystem::path &filepath);
+
+		const std::filesystem::path *Filepath{};
 		size_t Row{};
 		size_t Column{};
 	};
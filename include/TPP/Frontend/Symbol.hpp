@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string_view>
+
+namespace tpp
+{
+	enum Keyword : uint32_t
+	{
+		Keyword_,
+		Keyword_Include,
+		Keyword_Struct,
+		Keyword_Def,
+		Keyword_For,
+		Keyword_While,
+		Keyword_If,
+		Keyword_Else,
+		Keyword_PFor,
+		Keyword_Spawn,
+		Keyword_Sync,
+	};
+
+	struct Symbol
+	{
+		static Symbol Get(std::string_view string);
+
+		Symbol() = default;
+		constexpr Symbol(Keyword keyword) : Id(keyword) {}
+		constexpr explicit Symbol(uint32_t id) : Id(id) {}
+
+		std::string_view String() const;
+
+		explicit operator bool() const { return Id; }
+		bool operator!() const { return !Id; }
+
+		uint32_t Id = 0;
+	};
+
+	inline bool operator==(Symbol a, Symbol b) { return a.Id == b.Id; }
+	inline bool operator!=(Symbol a, Symbol b) { return a.Id != b.Id; }
+	inline bool operator<(Symbol a, Symbol b) { return a.Id < b.Id; }
+
+	std::ostream &operator<<(std::ostream &out, Symbol symbol);
+}
+
+template <>
+struct std::hash<tpp::Symbol>
+{
+	size_t operator()(tpp::Symbol symbol) const noexcept { return symbol.Id; }
+};
@@ -1,6 +1,9 @@
-#pragma
+#pragma once
 
-#include <TPP/Frontend/SourceLocation.hpp>
+#include <TPP/Frontend/Operator.hpp>
+#include <TPP/Frontend/Symbol.hpp>
+#include <cstddef>
+#include <string_view>
 
 namespace tpp
 {
@@ -17,8 +20,11 @@ namespace tpp
 
 	struct Token
 	{
-		SourceLocation Location;
 		TokenType Type = TokenType_;
-		std::string Value;
+		std::string_view Value;
+		Symbol Sym;
+		BinaryOp Op = BinaryOp_;
+		size_t Row{};
+		size_t Column{};
 	};
 }
@@ -1,21 +1,47 @@
 #pragma once
 
 #include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Symbol.hpp>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 namespace tpp
 {
+	enum TypeKind
+	{
+		TypeKind_Named,
+		TypeKind_I1,
+		TypeKind_I8,
+		TypeKind_I16,
+		TypeKind_I32,
+		TypeKind_I64,
+		TypeKind_I128,
+		TypeKind_F16,
+		TypeKind_F32,
+		TypeKind_F64,
+		TypeKind_Void,
+		TypeKind_Array,
+		TypeKind_Function,
+		TypeKind_Struct,
+		TypeKind_Future,
+		TypeKind_Vector,
+		TypeKind_FixedArray,
+	};
+
 	struct Type
 	{
-		static void Init();
+		static Arena &GetArena();
 
-		static TypePtr Create(const std::string &name);
-		static TypePtr CreateStruct(const std::string &name, const std::vector<StructElement> &elements);
+		static TypePtr CreateStruct(Symbol name, const std::vector<StructElement> &elements);
 
-		static TypePtr Get(const std::string &name, bool unsafe = false);
+		static TypePtr Get(Symbol name, bool unsafe = false);
+		static TypePtr GetDeferred(Symbol name);
 		static TypePtr GetArray(const TypePtr &base);
+		static TypePtr GetFixedArray(const TypePtr &base, unsigned count);
 		static TypePtr GetFunction(const TypePtr &result, const std::vector<TypePtr> &args, bool is_var_arg);
+		static TypePtr GetFuture(const TypePtr &base);
+		static TypePtr GetVector(const TypePtr &base, unsigned count);
 
 		static TypePtr GetI1();
 		static TypePtr GetI8();
@@ -28,14 +54,27 @@ namespace tpp
 		static TypePtr GetF64();
 		static TypePtr GetVoid();
 
-		explicit Type(const std::string &name);
+		Type(TypeKind kind, const std::string &name);
 		virtual ~Type();
 
+		template <typename T>
+		T *As()
+		{
+			return Kind == T::KIND ? static_cast<T *>(this) : nullptr;
+		}
+
+		TypeKind Kind;
 		std::string Name;
+
+		// memoized lowering, valid for the builder of generation IRGeneration only; a context address could be reused
+		uint64_t IRGeneration = 0;
+		llvm::Type *IR = nullptr;
 	};
 
 	struct ArrayType : Type
 	{
+		static constexpr TypeKind KIND = TypeKind_Array;
+
 		ArrayType(const std::string &name, const TypePtr &base);
 
 		TypePtr Base;
@@ -43,6 +82,8 @@ namespace tpp
 
 	struct FunctionType : Type
 	{
+		static constexpr TypeKind KIND = TypeKind_Function;
+
 		FunctionType(const std::string &name, const TypePtr &result, const std::vector<TypePtr> &args, bool is_var_arg);
 
 		TypePtr Result;
@@ -52,10 +93,44 @@ namespace tpp
 
 	struct StructType : Type
 	{
+		static constexpr TypeKind KIND = TypeKind_Struct;
+
 		StructType(const std::string &name, const std::vector<StructElement> &elements);
 
 		std::vector<StructElement> Elements;
 	};
 
+	// the handle of a spawned call, synced exactly once to get its result
+	struct FutureType : Type
+	{
+		static constexpr TypeKind KIND = TypeKind_Future;
+
+		FutureType(const std::string &name, const TypePtr &base);
+
+		TypePtr Base;
+	};
+
+	// a fixed number of lanes of a number type, named like v4f64; arithmetic applies lane by lane
+	struct VectorType : Type
+	{
+		static constexpr TypeKind KIND = TypeKind_Vector;
+
+		VectorType(const std::string &name, const TypePtr &base, unsigned count);
+
+		TypePtr Base;
+		unsigned Count;
+	};
+
+	// an array of a length known at compile time like f64[3], held by value and laid out inline where it is stored
+	struct FixedArrayType : Type
+	{
+		static constexpr TypeKind KIND = TypeKind_FixedArray;
+
+		FixedArrayType(const std::string &name, const TypePtr &base, unsigned count);
+
+		TypePtr Base;
+		unsigned Count;
+	};
+
 	std::ostream &operator<<(std::ostream &out, const TypePtr &ptr);
 }
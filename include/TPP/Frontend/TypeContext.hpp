@@ -0,0 +1,80 @@
+#pragma once
+
+#include <TPP/Frontend/Arena.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Symbol.hpp>
+#include <TPP/Frontend/Type.hpp>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tpp
+{
+	class TypeContext
+	{
+	public:
+		static TypeContext &Global();
+
+		TypeContext();
+
+		Arena &GetArena();
+
+		const TypePtr &GetPrimitive(TypeKind kind) const;
+
+		TypePtr Get(Symbol name, bool unsafe);
+		TypePtr GetDeferred(Symbol name);
+		TypePtr GetArray(const TypePtr &base);
+		TypePtr GetFixedArray(const TypePtr &base, unsigned count);
+		TypePtr GetFunction(const TypePtr &result, const std::vector<TypePtr> &args, bool is_var_arg);
+		TypePtr GetStruct(Symbol name, const std::vector<StructElement> &elements);
+		TypePtr GetFuture(const TypePtr &base);
+		TypePtr GetVector(const TypePtr &base, unsigned count);
+
+	private:
+		struct FunctionKey
+		{
+			bool operator==(const FunctionKey &other) const;
+
+			const Type *Result;
+			std::vector<const Type *> Args;
+			bool IsVarArg;
+		};
+
+		struct StructKey
+		{
+			bool operator==(const StructKey &other) const;
+
+			Symbol Name;
+			std::vector<const Type *> Elements;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const FunctionKey &key) const;
+			size_t operator()(const StructKey &key) const;
+		};
+
+		TypePtr GetUnresolved(Symbol name);
+		// the following expect m_Mutex to be held
+		TypePtr GetVectorUnlocked(const TypePtr &base, unsigned count);
+		TypePtr GetVectorByName(Symbol name);
+
+		TypePtr m_Primitives[TypeKind_Void + 1];
+
+		// guards everything below; primitives are immutable after construction
+		std::mutex m_Mutex;
+
+		std::unordered_map<Symbol, TypePtr> m_Named;
+		std::unordered_map<Symbol, TypePtr> m_Unresolved;
+		std::unordered_map<const Type *, TypePtr> m_Arrays;
+		std::map<std::pair<const Type *, unsigned>, TypePtr> m_FixedArrays;
+		std::unordered_map<FunctionKey, TypePtr, KeyHash> m_Functions;
+		std::unordered_map<StructKey, TypePtr, KeyHash> m_Structs;
+		std::unordered_map<const Type *, TypePtr> m_Futures;
+		std::map<std::pair<const Type *, unsigned>, TypePtr> m_Vectors;
+
+		Arena m_Arena;
+	};
+}
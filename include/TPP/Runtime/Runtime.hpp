@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// the runtime library linked into every program; it is plain c so that compiled code can call it directly
+extern "C"
+{
+	// runs body(context, begin, end) over disjoint chunks covering [from, to) on the worker pool and returns once every chunk ran;
+	// the pool has TPP_NUM_THREADS threads including the caller, the hardware concurrency by default
+	void tpp_parallel_for(int64_t from, int64_t to, void (*body)(void *context, int64_t begin, int64_t end), void *context);
+
+	// a spawned call goes through the frame returned by tpp_task_alloc: the caller stores the arguments, tpp_spawn queues body(frame) on the pool,
+	// tpp_sync waits for it, helping with queued work meanwhile, and the result is read from the frame before tpp_task_free releases it;
+	// spawns nested deeper than TPP_SPAWN_DEPTH, by default a few levels more than it takes to keep every thread busy, run inline
+	void *tpp_task_alloc(void (*body)(void *frame), int64_t frame_size);
+	void tpp_spawn(void *frame);
+	void tpp_sync(void *frame);
+	void tpp_task_free(void *frame);
+}
@@ -0,0 +1,304 @@
+#include <TPP/Runtime/Runtime.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+using Body = void (*)(void *context, int64_t begin, int64_t end);
+using TaskBody = void (*)(void *frame);
+
+namespace
+{
+	struct Job
+	{
+		Job(Body body, void *context, int64_t grain, int64_t count) : MBody(body), Context(context), Grain(grain), Remaining(count) {}
+
+		Body MBody;
+		void *Context;
+		int64_t Grain;
+		// iterations not yet run, the job is done and may go away once this drops to zero
+		std::atomic<int64_t> Remaining;
+	};
+
+	struct Task
+	{
+		Job *MJob;
+		int64_t Begin;
+		int64_t End;
+	};
+
+	// the owner pushes and pops at the back, thieves take from the front where the biggest ranges are
+	struct Queue
+	{
+		std::mutex Mutex;
+		std::deque<Task> Tasks;
+	};
+
+	class Pool
+	{
+	public:
+		explicit Pool(unsigned threads);
+		~Pool();
+
+		unsigned Threads() const;
+		void Run(Job &job, int64_t from, int64_t to);
+		// queues a job of a single iteration on the calling thread's queue
+		void Spawn(Job &job);
+		void Wait(Job &job);
+
+	private:
+		void Work(unsigned self);
+		void Execute(unsigned self, Task task);
+
+		void Push(unsigned self, const Task &task);
+		bool Pop(unsigned self, Task &task);
+		bool Steal(unsigned self, Task &task);
+
+		// queue 0 is shared by the threads outside the pool, every worker owns one of the others
+		std::vector<std::unique_ptr<Queue>> m_Queues;
+		std::vector<std::thread> m_Workers;
+
+		std::atomic<int64_t> m_Pending = 0;
+		std::atomic<unsigned> m_Sleeping = 0;
+		std::mutex m_Mutex;
+		std::condition_variable m_Wake;
+		bool m_Stop = false;
+	};
+
+	// a spawned call, its frame with the arguments and the result follows right behind it
+	struct Spawned
+	{
+		Spawned(Body body, TaskBody task_body, unsigned depth) : MJob(body, this, 1, 1), MBody(task_body), Depth(depth) {}
+
+		Job MJob;
+		TaskBody MBody;
+		unsigned Depth;
+	};
+}
+
+// frames start on their own cache line, which also keeps tasks running next to each other from sharing one
+static constexpr size_t FRAME_ALIGN = 64;
+static constexpr size_t FRAME_OFFSET = (sizeof(Spawned) + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1);
+
+static thread_local unsigned t_Self = 0;
+// how many spawns deep the task running on this thread is
+static thread_local unsigned t_Depth = 0;
+
+static unsigned thread_count()
+{
+	if (auto env = std::getenv("TPP_NUM_THREADS"))
+		if (auto count = std::strtoul(env, nullptr, 10)) return (unsigned) count;
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+static Pool &get_pool()
+{
+	static Pool pool(thread_count());
+	return pool;
+}
+
+Pool::Pool(unsigned threads)
+{
+	// the thread calling into the runtime works as well, so it takes one worker less
+	for (unsigned i = 0; i < threads; ++i) m_Queues.push_back(std::make_unique<Queue>());
+	for (unsigned i = 1; i < threads; ++i) m_Workers.emplace_back([this, i] { Work(i); });
+}
+
+Pool::~Pool()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Wake.notify_all();
+	for (auto &worker : m_Workers) worker.join();
+}
+
+unsigned Pool::Threads() const { return (unsigned) m_Queues.size(); }
+
+void Pool::Run(Job &job, int64_t from, int64_t to)
+{
+	Execute(t_Self, { &job, from, to });
+	Wait(job);
+}
+
+void Pool::Spawn(Job &job) { Push(t_Self, { &job, 0, 1 }); }
+
+void Pool::Wait(Job &job)
+{
+	auto self = t_Self;
+
+	// help out with whatever is queued until every iteration of this job ran, nested jobs finish the same way
+	while (job.Remaining.load(std::memory_order_acquire) > 0)
+	{
+		Task task;
+		if (Pop(self, task) || Steal(self, task)) Execute(self, task);
+		else std::this_thread::yield();
+	}
+}
+
+void Pool::Work(unsigned self)
+{
+	t_Self = self;
+	for (;;)
+	{
+		Task task;
+		if (Pop(self, task) || Steal(self, task))
+		{
+			Execute(self, task);
+			continue;
+		}
+
+		std::unique_lock lock(m_Mutex);
+		++m_Sleeping;
+		m_Wake.wait(lock, [this] { return m_Stop || m_Pending > 0; });
+		--m_Sleeping;
+		if (m_Stop) return;
+	}
+}
+
+void Pool::Execute(unsigned self, Task task)
+{
+	// keep the lower half and leave the upper one to be stolen until a single grain is left
+	auto &job = *task.MJob;
+	while (task.End - task.Begin > job.Grain)
+	{
+		auto middle = task.Begin + (task.End - task.Begin) / 2;
+		Push(self, { &job, middle, task.End });
+		task.End = middle;
+	}
+
+	job.MBody(job.Context, task.Begin, task.End);
+	job.Remaining.fetch_sub(task.End - task.Begin, std::memory_order_acq_rel);
+}
+
+void Pool::Push(unsigned self, const Task &task)
+{
+	{
+		auto &queue = *m_Queues[self];
+		std::lock_guard lock(queue.Mutex);
+		queue.Tasks.push_back(task);
+	}
+	++m_Pending;
+
+	// a worker counts itself as sleeping before it checks for work, so it either sees the task or gets woken up
+	if (m_Sleeping > 0)
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Wake.notify_one();
+	}
+}
+
+bool Pool::Pop(unsigned self, Task &task)
+{
+	auto &queue = *m_Queues[self];
+	std::lock_guard lock(queue.Mutex);
+	if (queue.Tasks.empty()) return false;
+
+	task = queue.Tasks.back();
+	queue.Tasks.pop_back();
+	--m_Pending;
+	return true;
+}
+
+bool Pool::Steal(unsigned self, Task &task)
+{
+	auto count = (unsigned) m_Queues.size();
+	for (unsigned i = 1; i < count; ++i)
+	{
+		auto &queue = *m_Queues[(self + i) % count];
+		std::lock_guard lock(queue.Mutex);
+		if (queue.Tasks.empty()) continue;
+
+		task = queue.Tasks.front();
+		queue.Tasks.pop_front();
+		--m_Pending;
+		return true;
+	}
+	return false;
+}
+
+void tpp_parallel_for(int64_t from, int64_t to, Body body, void *context)
+{
+	if (from >= to) return;
+
+	auto &pool = get_pool();
+	auto count = to - from;
+
+	// about eight chunks per thread leave enough to steal when iterations take uneven time, without splitting cheap loops too finely
+	auto grain = std::max<int64_t>(1, count / ((int64_t) pool.Threads() * 8));
+	if (pool.Threads() == 1 || count <= grain)
+	{
+		body(context, from, to);
+		return;
+	}
+
+	Job job(body, context, grain, count);
+	pool.Run(job, from, to);
+}
+
+static unsigned spawn_cutoff()
+{
+	if (auto env = std::getenv("TPP_SPAWN_DEPTH")) return (unsigned) std::strtoul(env, nullptr, 10);
+
+	// a binary recursion has about eight tasks per thread to balance at this depth, anything deeper is not worth queueing
+	unsigned depth = 3;
+	for (auto threads = get_pool().Threads() - 1; threads > 0; threads >>= 1) ++depth;
+	return depth;
+}
+
+static Spawned *get_spawned(void *frame) { return reinterpret_cast<Spawned *>(static_cast<char *>(frame) - FRAME_OFFSET); }
+
+static void run_spawned(void *context, int64_t, int64_t)
+{
+	auto &task = *static_cast<Spawned *>(context);
+	auto depth = t_Depth;
+	t_Depth = task.Depth;
+	task.MBody(reinterpret_cast<char *>(&task) + FRAME_OFFSET);
+	t_Depth = depth;
+}
+
+void *tpp_task_alloc(TaskBody body, int64_t frame_size)
+{
+	auto memory = ::operator new(FRAME_OFFSET + (size_t) frame_size, std::align_val_t(FRAME_ALIGN));
+	auto task = new (memory) Spawned(run_spawned, body, t_Depth + 1);
+	return reinterpret_cast<char *>(task) + FRAME_OFFSET;
+}
+
+void tpp_spawn(void *frame)
+{
+	static const auto cutoff = spawn_cutoff();
+
+	auto &task = *get_spawned(frame);
+	auto &pool = get_pool();
+
+	// past the cutoff there is enough parallelism already, the call runs right away like a plain one
+	if (pool.Threads() == 1 || task.Depth > cutoff)
+	{
+		run_spawned(&task, 0, 1);
+		task.MJob.Remaining.store(0, std::memory_order_relaxed);
+		return;
+	}
+
+	pool.Spawn(task.MJob);
+}
+
+void tpp_sync(void *frame)
+{
+	auto &task = *get_spawned(frame);
+	if (task.MJob.Remaining.load(std::memory_order_acquire) > 0) get_pool().Wait(task.MJob);
+}
+
+void tpp_task_free(void *frame)
+{
+	auto task = get_spawned(frame);
+	task->~Spawned();
+	::operator delete(task, std::align_val_t(FRAME_ALIGN));
+}
@@ -2,19 +2,36 @@
 #include <TPP/Backend/Value.hpp>
 #include <TPP/Frontend/Expression.hpp>
 #include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Profiler.hpp>
 #include <TPP/Frontend/SourceLocation.hpp>
 #include <TPP/Frontend/StructElement.hpp>
 #include <TPP/Frontend/Type.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Linker/Linker.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
-tpp::Builder::Builder(const std::string &source_filename)
+// tells the builders apart that memoize type lowerings on the shared types
+static std::atomic<uint64_t> next_generation{ 1 };
+
+tpp::Builder::Builder(const std::string &source_filename, Optimizer *optimizer) : m_Optimizer(optimizer), m_Generation(next_generation++)
 {
 	m_Context = std::make_unique<llvm::LLVMContext>();
 	m_Module = std::make_unique<llvm::Module>("module", *m_Context);
@@ -22,8 +39,6 @@ tpp::Builder::Builder(const std::string &source_filename)
 
 	m_Module->setSourceFileName(source_filename);
 
-	Type::Init();
-
 	{
 		auto function_type = llvm::FunctionType::get(IRBuilder().getVoidTy(), false);
 		m_Global = llvm::cast<llvm::Function>(Module().getOrInsertFunction(".global", function_type).getCallee());
@@ -32,79 +47,358 @@ tpp::Builder::Builder(const std::string &source_filename)
 	}
 }
 
+tpp::Builder::Builder(const Builder &parent, Optimizer *optimizer) : m_Optimizer(optimizer), m_Parent(&parent)
+{
+	m_Context = std::make_unique<llvm::LLVMContext>();
+	m_Module = std::make_unique<llvm::Module>(parent.Module().getModuleIdentifier(), *m_Context);
+	m_Builder = std::make_unique<llvm::IRBuilder<>>(*m_Context);
+
+	m_Module->setSourceFileName(parent.Module().getSourceFileName());
+	m_Module->setTargetTriple(parent.Module().getTargetTriple());
+	m_Module->setDataLayout(parent.Module().getDataLayout());
+
+	// declare everything the parent has seen so far, function bodies can then be lowered without it
+	m_Declared = parent.m_Declared;
+	for (const auto &[name, info] : parent.m_Functions)
+	{
+		auto function_type = llvm::cast<llvm::FunctionType>(GenIR(Type::GetFunction(info.Result, info.Args, info.IsVarArg)));
+		auto function = llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, info.Function->getName(), Module());
+		SetABIAttributes(m_Functions[name] = { function, info.Result, info.Args, info.IsVarArg, info.IsExtern });
+	}
+
+	for (const auto &[name, value] : parent.m_Variables)
+	{
+		auto lvalue = std::dynamic_pointer_cast<LValue>(value);
+		auto global = lvalue ? llvm::dyn_cast<llvm::GlobalVariable>(lvalue->GetPtr()) : nullptr;
+		if (!global) continue;
+
+		auto ptr = Module().getOrInsertGlobal(global->getName(), GenIR(value->GetType()));
+		m_Variables[name] = LValue::Create(*this, value->GetType(), ptr);
+	}
+}
+
 llvm::LLVMContext &tpp::Builder::Context() const { return *m_Context; }
 
 llvm::Module &tpp::Builder::Module() const { return *m_Module; }
 
 llvm::IRBuilder<> &tpp::Builder::IRBuilder() const { return *m_Builder; }
 
-bool tpp::Builder::IsGlobal() const { return m_Stack.empty(); }
+std::unique_ptr<llvm::LLVMContext> tpp::Builder::ReleaseContext()
+{
+	m_Builder.reset();
+	return std::move(m_Context);
+}
+
+std::unique_ptr<llvm::Module> tpp::Builder::ReleaseModule() { return std::move(m_Module); }
+
+bool tpp::Builder::IsGlobal() const { return m_Scopes.empty(); }
+
+void tpp::Builder::Finish()
+{
+	IRBuilder().SetInsertPoint(&m_Global->back());
+	IRBuilder().CreateRetVoid();
+
+	if (llvm::verifyFunction(*m_Global, &llvm::errs()))
+	{
+		m_Global->print(llvm::errs());
+		error(SourceLocation::UNKNOWN, "failed to verify global initializer");
+	}
+
+	// serial and parallel builds create functions and globals in different orders, so both are listed canonically:
+	// the program's functions as declared, then the outlined bodies of pfor and spawn by first reference, then runtime, library and intrinsic declarations by name;
+	// the program's globals as declared, then the private ones by first use
+	llvm::SmallPtrSet<llvm::Function *, 16> declared;
+	for (const auto &[name, info] : m_Functions) declared.insert(info.Function);
+
+	std::vector<llvm::Function *> functions, others;
+	llvm::SmallPtrSet<llvm::Function *, 16> listed;
+	for (auto &function : Module())
+		if (declared.count(&function) && listed.insert(&function).second) functions.push_back(&function);
+	for (size_t i = 0; i < functions.size(); ++i)
+		for (auto &instruction : llvm::instructions(*functions[i]))
+			for (auto &operand : instruction.operands())
+				if (auto function = llvm::dyn_cast<llvm::Function>(operand); function && function->hasLocalLinkage() && listed.insert(function).second) functions.push_back(function);
+	for (auto &function : Module())
+		if (!listed.count(&function)) (function.hasLocalLinkage() ? functions : others).push_back(&function);
+	std::sort(others.begin(), others.end(), [](llvm::Function *a, llvm::Function *b) { return a->getName() < b->getName(); });
+	for (auto list : { &functions, &others })
+		for (auto function : *list)
+		{
+			function->removeFromParent();
+			Module().getFunctionList().push_back(function);
+		}
+
+	std::vector<llvm::GlobalVariable *> globals;
+	llvm::SmallPtrSet<llvm::GlobalVariable *, 16> seen;
+	for (auto &global : Module().globals())
+		if (!global.hasPrivateLinkage() && seen.insert(&global).second) globals.push_back(&global);
+	for (auto &function : Module())
+		for (auto &instruction : llvm::instructions(function))
+			for (auto &operand : instruction.operands())
+				if (auto global = llvm::dyn_cast<llvm::GlobalVariable>(operand); global && seen.insert(global).second) globals.push_back(global);
+	for (auto &global : Module().globals())
+		if (seen.insert(&global).second) globals.push_back(&global);
+	for (auto global : globals)
+	{
+		global->removeFromParent();
+		Module().insertGlobalVariable(global);
+	}
+
+	llvm::appendToGlobalCtors(Module(), m_Global, 65535);
+}
+
+void tpp::Builder::Link(llvm::ArrayRef<llvm::MemoryBufferRef> modules)
+{
+	ProfileScope scope(ProfilePhase_Link);
+
+	// the linker replaces declarations with new functions and globals at the end of the module, keep the original order instead
+	std::vector<std::string> order, globals;
+	for (auto &function : Module()) order.push_back(function.getName().str());
+	for (auto &global : Module().globals())
+		if (global.hasName()) globals.push_back(global.getName().str());
+
+	for (const auto &buffer : modules)
+	{
+		auto module = llvm::parseBitcodeFile(buffer, Context());
+		if (!module) error(SourceLocation::UNKNOWN, "failed to read module %s: %s", buffer.getBufferIdentifier().str().c_str(), llvm::toString(module.takeError()).c_str());
+		if (llvm::Linker::linkModules(Module(), std::move(*module))) error(SourceLocation::UNKNOWN, "failed to link module %s", buffer.getBufferIdentifier().str().c_str());
+	}
+
+	for (const auto &name : order)
+	{
+		auto function = Module().getFunction(name);
+		if (!function) continue;
+		function->removeFromParent();
+		Module().getFunctionList().push_back(function);
+	}
+
+	for (const auto &name : globals)
+	{
+		auto global = Module().getGlobalVariable(name, true);
+		if (!global) continue;
+		global->removeFromParent();
+		Module().insertGlobalVariable(global);
+	}
+
+	for (auto &[name, info] : m_Functions) info.Function = Module().getFunction(name.String());
+}
 
 tpp::ValuePtr tpp::Builder::GenIR(const ExprPtr &ptr)
 {
 	if (!ptr) return nullptr;
 
-	if (auto p = std::dynamic_pointer_cast<DefFunctionExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<DefVariableExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<ForExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<WhileExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<IfExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<GroupExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<BinaryExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<CallExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<IndexExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<MemberExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<IDExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<NumberExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<CharExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<StringExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<VarArgsExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<UnaryExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<ObjectExpression>(ptr)) return GenIR(*p);
-	if (auto p = std::dynamic_pointer_cast<ArrayExpression>(ptr)) return GenIR(*p);
-
-	error(ptr->Location, "no GenIR implementation for this expression");
+	return Visit(*ptr, [this](const auto &e) { return GenIR(e); });
+}
+
+static std::pair<tpp::TypePtr, unsigned> get_elements(const tpp::TypePtr &type)
+{
+	if (auto vector = type->As<tpp::VectorType>()) return { vector->Base, vector->Count };
+	if (auto fixed = type->As<tpp::FixedArrayType>()) return { fixed->Base, fixed->Count };
+	return { nullptr, 0 };
+}
+
+tpp::ValuePtr tpp::Builder::GenIR(const ExprPtr &ptr, const TypePtr &context)
+{
+	// a list fills the lanes of a vector or a fixed array one by one, a literal goes to all of them
+	if (auto element = context && ptr ? get_elements(context).first : nullptr)
+	{
+		if (auto object = ptr->As<ObjectExpression>()) return CreateElements(*object, context);
+		if (auto number = ptr->As<NumberExpression>(); number && !number->Type) return CreateCast(CreateNumber(*number, number->GetType(element)), context);
+	}
+
+	auto number = ptr ? ptr->As<NumberExpression>() : nullptr;
+	if (!number || number->Type || !context) return GenIR(ptr);
+	return CreateNumber(*number, number->GetType(context));
 }
 
 llvm::Type *tpp::Builder::GenIR(const TypePtr &ptr)
 {
-	if (auto p = std::dynamic_pointer_cast<ArrayType>(ptr))
+	if (m_Parent)
+	{
+		auto &ref = m_IRTypes[ptr.get()];
+		if (!ref) ref = CreateIRType(ptr);
+		return ref;
+	}
+
+	if (ptr->IRGeneration != m_Generation)
+	{
+		ptr->IR = CreateIRType(ptr);
+		ptr->IRGeneration = m_Generation;
+	}
+	return ptr->IR;
+}
+
+llvm::Type *tpp::Builder::CreateIRType(const TypePtr &ptr)
+{
+	switch (ptr->Kind)
 	{
+	case TypeKind_I1: return IRBuilder().getInt1Ty();
+	case TypeKind_I8: return IRBuilder().getInt8Ty();
+	case TypeKind_I16: return IRBuilder().getInt16Ty();
+	case TypeKind_I32: return IRBuilder().getInt32Ty();
+	case TypeKind_I64: return IRBuilder().getInt64Ty();
+	case TypeKind_I128: return IRBuilder().getInt128Ty();
+	case TypeKind_F16: return IRBuilder().getHalfTy();
+	case TypeKind_F32: return IRBuilder().getFloatTy();
+	case TypeKind_F64: return IRBuilder().getDoubleTy();
+	case TypeKind_Void: return IRBuilder().getVoidTy();
+
+	case TypeKind_Array:
+	{
+		auto p = ptr->As<ArrayType>();
 		auto base = GenIR(p->Base);
 		return llvm::PointerType::get(base, 0);
 	}
 
-	if (auto p = std::dynamic_pointer_cast<FunctionType>(ptr))
+	case TypeKind_Function:
 	{
-		auto result = GenIR(p->Result);
-		std::vector<llvm::Type *> args(p->Args.size());
-		for (size_t i = 0; i < args.size(); ++i) args[i] = GenIR(p->Args[i]);
-		return llvm::FunctionType::get(result, args, p->IsVarArg);
+		// the signature is the lowered one, a result that goes through memory turns into a pointer in front of the arguments
+		auto p = ptr->As<FunctionType>();
+		auto result = GetABI(p->Result);
+		std::vector<llvm::Type *> args;
+		if (result.Kind == ABIKind_Indirect) args.push_back(result.IRType);
+		for (const auto &arg : p->Args) args.push_back(GetABI(arg).IRType);
+		return llvm::FunctionType::get(result.Kind == ABIKind_Indirect ? IRBuilder().getVoidTy() : result.IRType, args, p->IsVarArg);
 	}
 
-	if (auto p = std::dynamic_pointer_cast<StructType>(ptr))
+	case TypeKind_Struct:
 	{
+		auto p = ptr->As<StructType>();
 		std::vector<llvm::Type *> elements(p->Elements.size());
 		for (size_t i = 0; i < elements.size(); ++i) elements[i] = GenIR(p->Elements[i].MType);
 		return llvm::StructType::get(Context(), elements);
 	}
 
-	if (ptr == Type::GetI1()) return IRBuilder().getInt1Ty();
-	if (ptr == Type::GetI8()) return IRBuilder().getInt8Ty();
-	if (ptr == Type::GetI16()) return IRBuilder().getInt16Ty();
-	if (ptr == Type::GetI32()) return IRBuilder().getInt32Ty();
-	if (ptr == Type::GetI64()) return IRBuilder().getInt64Ty();
-	if (ptr == Type::GetI128()) return IRBuilder().getInt128Ty();
-	if (ptr == Type::GetF16()) return IRBuilder().getHalfTy();
-	if (ptr == Type::GetF32()) return IRBuilder().getFloatTy();
-	if (ptr == Type::GetF64()) return IRBuilder().getDoubleTy();
-	if (ptr == Type::GetVoid()) return IRBuilder().getVoidTy();
+	case TypeKind_Future: return llvm::PointerType::get(Context(), 0);
 
-	if (auto type = llvm::StructType::getTypeByName(Context(), ptr->Name)) return type;
+	case TypeKind_Vector:
+	{
+		auto p = ptr->As<VectorType>();
+		return llvm::FixedVectorType::get(GenIR(p->Base), p->Count);
+	}
+
+	case TypeKind_FixedArray:
+	{
+		auto p = ptr->As<FixedArrayType>();
+		return llvm::ArrayType::get(GenIR(p->Base), p->Count);
+	}
+
+	case TypeKind_Named:
+		// placeholders left by concurrent parsing mean whatever the name is bound to by now
+		if (auto type = Type::Get(Symbol::Get(ptr->Name), true); type->Kind != TypeKind_Named) return GenIR(type);
+		if (auto type = llvm::StructType::getTypeByName(Context(), ptr->Name)) return type;
+		break;
+
+	default: break;
+	}
 
 	error(SourceLocation::UNKNOWN, "no such type: %s", ptr->Name.c_str());
 }
 
+// sysv x86-64: an eightbyte is passed in an sse register if only f32 and f64 live in it, in an integer register otherwise
+static void classify(const llvm::DataLayout &layout, llvm::Type *type, uint64_t offset, bool integer[2], bool f64[2])
+{
+	if (auto struct_type = llvm::dyn_cast<llvm::StructType>(type))
+	{
+		auto struct_layout = layout.getStructLayout(struct_type);
+		for (unsigned i = 0; i < struct_type->getNumElements(); ++i) classify(layout, struct_type->getElementType(i), offset + struct_layout->getElementOffset(i), integer, f64);
+		return;
+	}
+
+	if (auto array_type = llvm::dyn_cast<llvm::ArrayType>(type))
+	{
+		auto element = array_type->getElementType();
+		auto stride = layout.getTypeAllocSize(element).getFixedValue();
+		for (uint64_t i = 0; i < array_type->getNumElements(); ++i) classify(layout, element, offset + i * stride, integer, f64);
+		return;
+	}
+
+	if (type->isVectorTy() && (type->getScalarType()->isFloatTy() || type->getScalarType()->isDoubleTy()))
+	{
+		auto element = type->getScalarType();
+		auto stride = layout.getTypeAllocSize(element).getFixedValue();
+		for (unsigned i = 0; i < llvm::cast<llvm::FixedVectorType>(type)->getNumElements(); ++i) classify(layout, element, offset + i * stride, integer, f64);
+		return;
+	}
+
+	if (type->isDoubleTy()) f64[offset / 8] = true;
+	else if (!type->isFloatTy())
+		for (auto last = offset + layout.getTypeStoreSize(type).getFixedValue() - 1; offset <= last; offset += 8) integer[offset / 8] = true;
+}
+
+tpp::ABIInfo tpp::Builder::GetABI(const TypePtr &type)
+{
+	auto ir_type = GenIR(type);
+	if (!ir_type->isAggregateType()) return { ABIKind_Direct, ir_type };
+
+	// aggregates of up to 16 bytes travel in one register per eightbyte, anything larger goes through memory
+	const auto &layout = Module().getDataLayout();
+	auto size = layout.getTypeStoreSize(ir_type).getFixedValue();
+	if (size == 0) return { ABIKind_Direct, ir_type };
+	if (size > 16) return { ABIKind_Indirect, llvm::PointerType::get(Context(), 0) };
+
+	bool integer[2]{}, f64[2]{};
+	classify(layout, ir_type, 0, integer, f64);
+
+	std::vector<llvm::Type *> eightbytes;
+	for (uint64_t offset = 0; offset < size; offset += 8)
+	{
+		auto bytes = std::min<uint64_t>(size - offset, 8);
+		if (integer[offset / 8]) eightbytes.push_back(IRBuilder().getIntNTy(bytes * 8));
+		else if (f64[offset / 8]) eightbytes.push_back(IRBuilder().getDoubleTy());
+		else if (bytes > 4) eightbytes.push_back(llvm::FixedVectorType::get(IRBuilder().getFloatTy(), 2));
+		else eightbytes.push_back(IRBuilder().getFloatTy());
+	}
+	return { ABIKind_Coerce, eightbytes.size() == 1 ? eightbytes[0] : llvm::StructType::get(Context(), eightbytes) };
+}
+
+void tpp::Builder::SetABIAttributes(const FunctionInfo &info)
+{
+	const auto &layout = Module().getDataLayout();
+	auto function = info.Function;
+	unsigned first = 0;
+
+	// the caller hands in the memory a large result is written to
+	if (GetABI(info.Result).Kind == ABIKind_Indirect)
+	{
+		auto ir_type = GenIR(info.Result);
+		function->addParamAttr(0, llvm::Attribute::getWithStructRetType(Context(), ir_type));
+		function->addParamAttr(0, llvm::Attribute::NoAlias);
+		function->addParamAttr(0, llvm::Attribute::getWithAlignment(Context(), layout.getABITypeAlign(ir_type)));
+		first = 1;
+	}
+
+	// and points to large arguments: a copy on the stack for c, which is what byval means, the caller's memory for a t++ definition that only reads it
+	for (unsigned i = 0; i < info.Args.size(); ++i)
+	{
+		if (GetABI(info.Args[i]).Kind != ABIKind_Indirect) continue;
+
+		auto ir_type = GenIR(info.Args[i]);
+		if (info.IsExtern)
+		{
+			function->addParamAttr(first + i, llvm::Attribute::getWithByValType(Context(), ir_type));
+			function->addParamAttr(first + i, llvm::Attribute::getWithAlignment(Context(), std::max(layout.getABITypeAlign(ir_type), llvm::Align(8))));
+			continue;
+		}
+
+		function->addParamAttr(first + i, llvm::Attribute::NoAlias);
+		function->addParamAttr(first + i, llvm::Attribute::NoCapture);
+		function->addParamAttr(first + i, llvm::Attribute::ReadOnly);
+		function->addParamAttr(first + i, llvm::Attribute::getWithDereferenceableBytes(Context(), layout.getTypeAllocSize(ir_type).getFixedValue()));
+		function->addParamAttr(first + i, llvm::Attribute::getWithAlignment(Context(), layout.getABITypeAlign(ir_type)));
+	}
+}
+
+llvm::Value *tpp::Builder::CreateCoercionSlot(llvm::Type *type, llvm::Type *coerced)
+{
+	// the registers may cover more bytes than the value, e.g. {f32, f32, f32} in <2 x f32> and f32
+	const auto &layout = Module().getDataLayout();
+	auto larger = layout.getTypeAllocSize(coerced).getFixedValue() > layout.getTypeAllocSize(type).getFixedValue() ? coerced : type;
+	auto slot = llvm::cast<llvm::AllocaInst>(CreateAlloca(larger));
+	slot->setAlignment(std::max(layout.getABITypeAlign(type), layout.getABITypeAlign(coerced)));
+	return slot;
+}
+
 llvm::Value *tpp::Builder::CreateAlloca(llvm::Type *type)
 {
 	auto backup_block = IRBuilder().GetInsertBlock();
@@ -114,7 +408,24 @@ llvm::Value *tpp::Builder::CreateAlloca(llvm::Type *type)
 	return ptr;
 }
 
-llvm::Value *tpp::Builder::GetDefault(const TypePtr &type) { error(SourceLocation::UNKNOWN, "no default: %s", type->Name.c_str()); }
+llvm::Value *tpp::Builder::GetDefault(const TypePtr &type)
+{
+	// like globals, variables without an initializer start out as zero, except for struct fields that declare their own
+	auto ir_type = GenIR(type);
+	if (ir_type->isVoidTy() || ir_type->isFunctionTy()) error(SourceLocation::UNKNOWN, "no default: %s", type->Name.c_str());
+
+	auto resolved = type->Kind == TypeKind_Named ? Type::Get(Symbol::Get(type->Name), true) : type;
+	llvm::Value *result = llvm::Constant::getNullValue(ir_type);
+	if (auto struct_type = resolved->As<StructType>())
+		for (unsigned i = 0; i < struct_type->Elements.size(); ++i)
+		{
+			// nested structs bring the initializers of their own fields; constant ones fold, so globals keep a static initializer
+			const auto &element = struct_type->Elements[i];
+			auto value = element.Init ? CreateCast(GenIR(element.Init, element.MType), element.MType)->Get() : GetDefault(element.MType);
+			result = IRBuilder().CreateInsertValue(result, value, i);
+		}
+	return result;
+}
 
 tpp::ValuePtr tpp::Builder::CreateCast(const ValuePtr &value, const TypePtr &type)
 {
@@ -126,31 +437,62 @@ tpp::ValuePtr tpp::Builder::CreateCast(const ValuePtr &value, const TypePtr &typ
 
 	if (value_type == ir_type) return value;
 
-	if (value_type->isPointerTy())
+	// a scalar is broadcast to every lane, vectors of the same length convert lane by lane
+	if (auto vector = type->As<VectorType>(); vector && !value_type->isVectorTy())
+		return RValue::Create(*this, type, IRBuilder().CreateVectorSplat(vector->Count, CreateCast(value, vector->Base)->Get()));
+	if (auto fixed = type->As<FixedArrayType>(); fixed && !value_type->isArrayTy())
 	{
-		if (ir_type->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreatePtrToInt(value->Get(), ir_type));
+		auto element = CreateCast(value, fixed->Base)->Get();
+		llvm::Value *result = llvm::PoisonValue::get(ir_type);
+		for (unsigned i = 0; i < fixed->Count; ++i) result = IRBuilder().CreateInsertValue(result, element, i);
+		return RValue::Create(*this, type, result);
 	}
-	else if (value_type->isIntegerTy())
+	if (value_type->isVectorTy() && !(ir_type->isVectorTy() && llvm::cast<llvm::FixedVectorType>(value_type)->getNumElements() == llvm::cast<llvm::FixedVectorType>(ir_type)->getNumElements()))
+		error(SourceLocation::UNKNOWN, "no such cast: %s -> %s", value->GetType()->Name.c_str(), type->Name.c_str());
+
+	auto value_scalar = value_type->getScalarType();
+	auto ir_scalar = ir_type->getScalarType();
+
+	if (value_scalar->isPointerTy())
 	{
-		if (ir_type->isPointerTy()) return RValue::Create(*this, type, IRBuilder().CreateIntToPtr(value->Get(), ir_type));
-		if (ir_type->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateIntCast(value->Get(), ir_type, true));
-		if (ir_type->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateSIToFP(value->Get(), ir_type));
+		if (ir_scalar->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreatePtrToInt(value->Get(), ir_type));
 	}
-	else if (value_type->isFloatingPointTy())
+	else if (value_scalar->isIntegerTy())
 	{
-		if (ir_type->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateFPToSI(value->Get(), ir_type));
-		if (ir_type->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateFPCast(value->Get(), ir_type));
+		if (ir_scalar->isPointerTy()) return RValue::Create(*this, type, IRBuilder().CreateIntToPtr(value->Get(), ir_type));
+		if (ir_scalar->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateIntCast(value->Get(), ir_type, true));
+		if (ir_scalar->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateSIToFP(value->Get(), ir_type));
+	}
+	else if (value_scalar->isFloatingPointTy())
+	{
+		if (ir_scalar->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateFPToSI(value->Get(), ir_type));
+		if (ir_scalar->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateFPCast(value->Get(), ir_type));
 	}
 
 	error(SourceLocation::UNKNOWN, "no such cast: %s -> %s", TypeToString(value_type), TypeToString(ir_type));
 }
 
-void tpp::Builder::Push() { m_Stack.push_back(m_Variables); }
+void tpp::Builder::Push() { m_Scopes.push_back(m_Undo.size()); }
 
 void tpp::Builder::Pop()
 {
-	m_Variables = m_Stack.back();
-	m_Stack.pop_back();
+	auto mark = m_Scopes.back();
+	m_Scopes.pop_back();
+
+	while (m_Undo.size() > mark)
+	{
+		auto &entry = m_Undo.back();
+		if (entry.Previous) m_Variables[entry.MName] = std::move(entry.Previous);
+		else m_Variables.erase(entry.MName);
+		m_Undo.pop_back();
+	}
+}
+
+void tpp::Builder::Bind(const Name &name, const ValuePtr &value)
+{
+	auto &ref = m_Variables[name];
+	if (!m_Scopes.empty()) m_Undo.push_back({ name, std::move(ref) });
+	ref = value;
 }
 
 tpp::ValuePtr tpp::Builder::DefineVariable(const Name &name, const TypePtr &type, const ValuePtr &value)
@@ -158,19 +500,40 @@ tpp::ValuePtr tpp::Builder::DefineVariable(const Name &name, const TypePtr &type
 	ValuePtr var;
 	if (IsGlobal())
 	{
-		auto ptr = Module().getOrInsertGlobal(name.String(), GenIR(type));
+		auto ir_type = GenIR(type);
+		auto ptr = llvm::cast<llvm::GlobalVariable>(Module().getOrInsertGlobal(name.String(), ir_type));
 		auto lvalue = LValue::Create(*this, type, ptr);
-		if (value) lvalue->Store(value);
+		m_Declared.emplace(name, m_Declared.size());
+
+		// a first definition without a value still takes the default, struct field initializers included
+		auto initial = value;
+		if (!initial && !ptr->hasInitializer()) initial = RValue::Create(*this, type, GetDefault(type));
+
+		// a constant first definition is the static initializer, everything else is stored when the global initializer runs
+		llvm::Constant *constant = nullptr;
+		if (auto rvalue = std::dynamic_pointer_cast<RValue>(initial); rvalue && llvm::isa<llvm::Constant>(rvalue->Get()) && !ptr->hasInitializer())
+			constant = llvm::dyn_cast<llvm::Constant>(CreateCast(rvalue, type)->Get());
+
+		if (!ptr->hasInitializer()) ptr->setInitializer(constant ? constant : llvm::Constant::getNullValue(ir_type));
+		if (initial && !constant) lvalue->Store(initial);
 		var = lvalue;
 	}
 	else { var = LValue::Alloca(*this, type, value); }
-	return m_Variables[name.String()] = var;
+	Bind(name, var);
+	return var;
 }
 
 tpp::TypePtr tpp::Builder::GetHigherOrder(const TypePtr &a, const TypePtr &b)
 {
 	if (a == b) return a;
 
+	// vectors combine lane by lane, with a scalar taking part in every lane
+	auto vector_a = a->As<VectorType>();
+	auto vector_b = b->As<VectorType>();
+	if (vector_a && vector_b && vector_a->Count == vector_b->Count) return Type::GetVector(GetHigherOrder(vector_a->Base, vector_b->Base), vector_a->Count);
+	if (vector_a && !vector_b && b->Kind >= TypeKind_I1 && b->Kind <= TypeKind_F64) return Type::GetVector(GetHigherOrder(vector_a->Base, b), vector_a->Count);
+	if (vector_b && !vector_a && a->Kind >= TypeKind_I1 && a->Kind <= TypeKind_F64) return Type::GetVector(GetHigherOrder(a, vector_b->Base), vector_b->Count);
+
 	auto ir_a = GenIR(a);
 	auto ir_b = GenIR(b);
 
@@ -225,12 +588,19 @@ tpp::ValuePtr tpp::Builder::CreateAssign(const ValuePtr &dest, const ValuePtr &s
 	return lvalue;
 }
 
+tpp::TypePtr tpp::Builder::GetBoolType(const TypePtr &type)
+{
+	// comparing vectors yields a mask with a flag for every lane
+	if (auto vector = type->As<VectorType>()) return Type::GetVector(Type::GetI1(), vector->Count);
+	return Type::GetI1();
+}
+
 tpp::ValuePtr tpp::Builder::CreateLT(const ValuePtr &lhs, const ValuePtr &rhs)
 {
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateICmpSLT(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateFCmpOLT(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateICmpSLT(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateFCmpOLT(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -239,8 +609,8 @@ tpp::ValuePtr tpp::Builder::CreateGT(const ValuePtr &lhs, const ValuePtr &rhs)
 {
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateICmpSGT(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateFCmpOGT(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateICmpSGT(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateFCmpOGT(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -249,8 +619,8 @@ tpp::ValuePtr tpp::Builder::CreateLE(const ValuePtr &lhs, const ValuePtr &rhs)
 {
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateICmpSLE(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateFCmpOLE(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateICmpSLE(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateFCmpOLE(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -259,8 +629,8 @@ tpp::ValuePtr tpp::Builder::CreateGE(const ValuePtr &lhs, const ValuePtr &rhs)
 {
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateICmpSGE(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateFCmpOGE(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateICmpSGE(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateFCmpOGE(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -269,8 +639,8 @@ tpp::ValuePtr tpp::Builder::CreateEQ(const ValuePtr &lhs, const ValuePtr &rhs)
 {
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateICmpEQ(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateFCmpOEQ(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateICmpEQ(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateFCmpOEQ(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -279,8 +649,8 @@ tpp::ValuePtr tpp::Builder::CreateNE(const ValuePtr &lhs, const ValuePtr &rhs)
 {
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateICmpNE(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, Type::GetI1(), IRBuilder().CreateFCmpONE(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateICmpNE(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, GetBoolType(lhs->GetType()), IRBuilder().CreateFCmpONE(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -290,8 +660,8 @@ tpp::ValuePtr tpp::Builder::CreateAdd(const ValuePtr &lhs, const ValuePtr &rhs)
 	auto type = lhs->GetType();
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateAdd(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateFAdd(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateAdd(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateFAdd(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -301,8 +671,8 @@ tpp::ValuePtr tpp::Builder::CreateSub(const ValuePtr &lhs, const ValuePtr &rhs)
 	auto type = lhs->GetType();
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateSub(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateFSub(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateSub(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateFSub(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -312,8 +682,8 @@ tpp::ValuePtr tpp::Builder::CreateMul(const ValuePtr &lhs, const ValuePtr &rhs)
 	auto type = lhs->GetType();
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateMul(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateFMul(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateMul(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateFMul(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -323,8 +693,8 @@ tpp::ValuePtr tpp::Builder::CreateDiv(const ValuePtr &lhs, const ValuePtr &rhs)
 	auto type = lhs->GetType();
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateSDiv(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateFDiv(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateSDiv(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateFDiv(lhs->Get(), rhs->Get()));
 
 	return {};
 }
@@ -334,16 +704,185 @@ tpp::ValuePtr tpp::Builder::CreateRem(const ValuePtr &lhs, const ValuePtr &rhs)
 	auto type = lhs->GetType();
 	auto ir_type = lhs->GetIRType();
 
-	if (ir_type->isIntegerTy()) return RValue::Create(*this, type, IRBuilder().CreateSRem(lhs->Get(), rhs->Get()));
-	if (ir_type->isFloatingPointTy()) return RValue::Create(*this, type, IRBuilder().CreateFRem(lhs->Get(), rhs->Get()));
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateSRem(lhs->Get(), rhs->Get()));
+	if (ir_type->isFPOrFPVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateFRem(lhs->Get(), rhs->Get()));
 
 	return {};
 }
 
-tpp::ValuePtr tpp::Builder::GenIR(const DefFunctionExpression &e)
+tpp::ValuePtr tpp::Builder::CreateAnd(const ValuePtr &lhs, const ValuePtr &rhs)
+{
+	auto type = lhs->GetType();
+	auto ir_type = lhs->GetIRType();
+
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateAnd(lhs->Get(), rhs->Get()));
+
+	return {};
+}
+
+tpp::ValuePtr tpp::Builder::CreateOr(const ValuePtr &lhs, const ValuePtr &rhs)
+{
+	auto type = lhs->GetType();
+	auto ir_type = lhs->GetIRType();
+
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateOr(lhs->Get(), rhs->Get()));
+
+	return {};
+}
+
+tpp::ValuePtr tpp::Builder::CreateXor(const ValuePtr &lhs, const ValuePtr &rhs)
+{
+	auto type = lhs->GetType();
+	auto ir_type = lhs->GetIRType();
+
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateXor(lhs->Get(), rhs->Get()));
+
+	return {};
+}
+
+tpp::ValuePtr tpp::Builder::CreateShl(const ValuePtr &lhs, const ValuePtr &rhs)
+{
+	auto type = lhs->GetType();
+	auto ir_type = lhs->GetIRType();
+
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateShl(lhs->Get(), rhs->Get()));
+
+	return {};
+}
+
+tpp::ValuePtr tpp::Builder::CreateAShr(const ValuePtr &lhs, const ValuePtr &rhs)
+{
+	auto type = lhs->GetType();
+	auto ir_type = lhs->GetIRType();
+
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateAShr(lhs->Get(), rhs->Get()));
+
+	return {};
+}
+
+tpp::ValuePtr tpp::Builder::CreateLShr(const ValuePtr &lhs, const ValuePtr &rhs)
+{
+	auto type = lhs->GetType();
+	auto ir_type = lhs->GetIRType();
+
+	if (ir_type->isIntOrIntVectorTy()) return RValue::Create(*this, type, IRBuilder().CreateLShr(lhs->Get(), rhs->Get()));
+
+	return {};
+}
+
+std::pair<tpp::ValuePtr, tpp::ValuePtr> tpp::Builder::GenOperands(const ExprPtr &lhs, const ExprPtr &rhs)
+{
+	// an unsuffixed literal on the left takes the type of the right operand, otherwise the right one follows the left
+	if (auto number = lhs->As<NumberExpression>(); number && !number->Type)
+	{
+		auto right = GenIR(rhs);
+		return { GenIR(lhs, right ? right->GetType() : nullptr), right };
+	}
+
+	auto left = GenIR(lhs);
+	return { left, GenIR(rhs, left ? left->GetType() : nullptr) };
+}
+
+tpp::ValuePtr tpp::Builder::CreateNumber(const NumberExpression &e, const TypePtr &type)
+{
+	auto ir_type = GenIR(type);
+	if (ir_type->isIntegerTy()) return RValue::Create(*this, type, llvm::ConstantInt::get(ir_type, e.IsInteger ? e.Integer : (int64_t) e.Value, true));
+	return RValue::Create(*this, type, llvm::ConstantFP::get(ir_type, e.IsInteger ? (double) e.Integer : e.Value));
+}
+
+llvm::Value *tpp::Builder::CreateBool(const ValuePtr &value)
+{
+	auto ir_type = value->GetIRType();
+
+	if (ir_type->isIntegerTy(1)) return value->Get();
+	if (ir_type->isIntegerTy()) return IRBuilder().CreateIsNotNull(value->Get());
+	if (ir_type->isFloatingPointTy()) return IRBuilder().CreateFCmpUNE(value->Get(), llvm::ConstantFP::get(ir_type, 0.0));
+	if (ir_type->isPointerTy()) return IRBuilder().CreateIsNotNull(value->Get());
+
+	return nullptr;
+}
+
+tpp::ValuePtr tpp::Builder::CreateLogical(const BinaryExpression &e)
+{
+	// '&&' and '||' only evaluate the right operand if the left one does not decide the result
+	bool is_and = e.Operator == BinaryOp_LAnd;
+
+	auto lhs = CreateBool(GenIR(e.Lhs));
+	if (!lhs) error(e.Location, "no such operation: %s", GetInfo(e.Operator).Text.data());
+
+	auto function = IRBuilder().GetInsertBlock()->getParent();
+	auto lhs_block = IRBuilder().GetInsertBlock();
+	auto rhs_block = llvm::BasicBlock::Create(Context(), is_and ? "and.rhs" : "or.rhs", function);
+	auto end_block = llvm::BasicBlock::Create(Context(), is_and ? "and.end" : "or.end", function);
+
+	if (is_and) IRBuilder().CreateCondBr(lhs, rhs_block, end_block);
+	else IRBuilder().CreateCondBr(lhs, end_block, rhs_block);
+
+	IRBuilder().SetInsertPoint(rhs_block);
+	auto rhs = CreateBool(GenIR(e.Rhs));
+	if (!rhs) error(e.Location, "no such operation: %s", GetInfo(e.Operator).Text.data());
+	rhs_block = IRBuilder().GetInsertBlock();
+	IRBuilder().CreateBr(end_block);
+
+	IRBuilder().SetInsertPoint(end_block);
+	auto phi = IRBuilder().CreatePHI(IRBuilder().getInt1Ty(), 2);
+	phi->addIncoming(IRBuilder().getInt1(!is_and), lhs_block);
+	phi->addIncoming(rhs, rhs_block);
+	return RValue::Create(*this, Type::GetI1(), phi);
+}
+
+llvm::Value *tpp::Builder::CreateCondition(const ExprPtr &ptr)
+{
+	auto value = GenIR(ptr);
+	auto condition = value ? CreateBool(value) : nullptr;
+	if (!condition) error(ptr->Location, "condition must be a number or pointer");
+	return condition;
+}
+
+llvm::MDNode *tpp::Builder::CreateLoopMetadata(const LoopHints &hints)
+{
+	if (!hints.Vectorize && !hints.Unroll) return nullptr;
+
+	auto flag = [this](const char *name) -> llvm::Metadata * { return llvm::MDNode::get(Context(), llvm::MDString::get(Context(), name)); };
+	auto option = [this](const char *name, llvm::Constant *value) -> llvm::Metadata *
+	{ return llvm::MDNode::get(Context(), { llvm::MDString::get(Context(), name), llvm::ConstantAsMetadata::get(value) }); };
+
+	// the first operand of a loop id is the node itself
+	std::vector<llvm::Metadata *> operands{ nullptr };
+
+	// like clang, a width of 1 only disables vectorizing
+	if (hints.Vectorize && hints.VectorizeWidth != 1) operands.push_back(option("llvm.loop.vectorize.enable", IRBuilder().getTrue()));
+	if (hints.Vectorize && hints.VectorizeWidth) operands.push_back(option("llvm.loop.vectorize.width", IRBuilder().getInt32(hints.VectorizeWidth)));
+
+	if (hints.Unroll && !hints.UnrollCount) operands.push_back(flag("llvm.loop.unroll.enable"));
+	else if (hints.Unroll && hints.UnrollCount == 1) operands.push_back(flag("llvm.loop.unroll.disable"));
+	else if (hints.Unroll) operands.push_back(option("llvm.loop.unroll.count", IRBuilder().getInt32(hints.UnrollCount)));
+
+	auto loop = llvm::MDNode::getDistinct(Context(), operands);
+	loop->replaceOperandWith(0, loop);
+	return loop;
+}
+
+void tpp::Builder::FinishFunction(llvm::Function &function, const SourceLocation &location)
 {
-	auto result_type = e.Result ? GenIR(e.Result) : IRBuilder().getVoidTy();
+	{
+		ProfileScope verify(ProfilePhase_Verify);
+		if (llvm::verifyFunction(function, &llvm::errs()))
+		{
+			function.print(llvm::errs());
+			error(location, "failed to verify function");
+		}
+	}
+
+	if (m_Optimizer)
+	{
+		ProfileScope optimize(ProfilePhase_OptimizeFunction);
+		m_Optimizer->Run(function);
+	}
+}
 
+const tpp::FunctionInfo &tpp::Builder::DeclareFunction(const DefFunctionExpression &e)
+{
 	std::vector<TypePtr> arg_types(e.Args.size());
 	for (size_t i = 0; i < arg_types.size(); ++i) arg_types[i] = e.Args[i].Type;
 
@@ -353,13 +892,45 @@ tpp::ValuePtr tpp::Builder::GenIR(const DefFunctionExpression &e)
 	auto callee = Module().getOrInsertFunction(e.MName.String(), ir_function_type);
 	auto function = llvm::cast<llvm::Function>(callee.getCallee());
 
-	m_FunctionInfos[function] = { function, e.Result, arg_types, e.IsVarArg };
-
 	if (!function) error(e.Location, "failed to create function");
 
+	// a definition after a prototype keeps the convention that callers of the prototype already use
+	auto previous = m_Functions.find(e.MName);
+	auto is_extern = previous != m_Functions.end() ? previous->second.IsExtern : !e.Body;
+	const auto &info = m_Functions[e.MName] = { function, e.Result, arg_types, e.IsVarArg, is_extern };
+	m_Declared.emplace(e.MName, m_Declared.size());
+	SetABIAttributes(info);
+	return info;
+}
+
+size_t tpp::Builder::Declarations() const { return m_Declared.size(); }
+
+void tpp::Builder::LimitDeclarations(size_t declarations) { m_DeclarationLimit = declarations; }
+
+bool tpp::Builder::IsDeclared(const Name &name) const
+{
+	auto it = m_Declared.find(name);
+	return it != m_Declared.end() && it->second < m_DeclarationLimit;
+}
+
+const tpp::FunctionInfo *tpp::Builder::FindFunction(const Name &name) const
+{
+	auto it = m_Functions.find(name);
+	return it != m_Functions.end() && IsDeclared(name) ? &it->second : nullptr;
+}
+
+tpp::ValuePtr tpp::Builder::GenIR(const DefFunctionExpression &e)
+{
+	const auto &info = DeclareFunction(e);
+	auto function = info.Function;
+	auto function_type = Type::GetFunction(info.Result, info.Args, info.IsVarArg);
+	auto result_abi = GetABI(info.Result);
+
 	if (!e.Body) return nullptr;
 	if (!function->empty()) error(e.Location, "function cannot be redefined");
 
+	ProfileScope scope(ProfilePhase_GenFunction, [&e] { return e.MName.String(); });
+
 	auto backup_block = IRBuilder().GetInsertBlock();
 
 	auto entry_block = llvm::BasicBlock::Create(Context(), "entry", function);
@@ -367,86 +938,279 @@ tpp::ValuePtr tpp::Builder::GenIR(const DefFunctionExpression &e)
 
 	Push();
 	{
-		size_t i = 0;
-		for (auto &arg : function->args())
+		const auto &layout = Module().getDataLayout();
+		auto arg = function->arg_begin();
+		if (result_abi.Kind == ABIKind_Indirect) (arg++)->setName("result");
+
+		for (size_t i = 0; i < e.Args.size(); ++i, ++arg)
 		{
 			auto name = e.Args[i].Name;
-			arg.setName(name);
-			m_Variables[name] = LValue::Alloca(*this, e.Args[i].Type, &arg);
-			++i;
+			auto type = e.Args[i].Type;
+			arg->setName(llvm::StringRef(name.String()));
+
+			auto abi = GetABI(type);
+			if (abi.Kind == ABIKind_Direct)
+			{
+				Bind(name, LValue::Alloca(*this, type, &*arg));
+				continue;
+			}
+
+			auto ir_type = GenIR(type);
+			if (abi.Kind == ABIKind_Coerce)
+			{
+				auto slot = CreateCoercionSlot(ir_type, abi.IRType);
+				IRBuilder().CreateStore(&*arg, slot);
+				Bind(name, LValue::Create(*this, type, slot));
+				continue;
+			}
+
+			// the caller's memory is read-only; the copy goes away again unless the body writes to the argument
+			auto align = layout.getABITypeAlign(ir_type);
+			auto slot = CreateAlloca(ir_type);
+			IRBuilder().CreateMemCpy(slot, align, &*arg, align, layout.getTypeAllocSize(ir_type).getFixedValue());
+			Bind(name, LValue::Create(*this, type, slot));
 		}
 	}
 
-	auto result = GenIR(e.Body);
-	if (result_type == IRBuilder().getVoidTy()) { IRBuilder().CreateRetVoid(); }
-	else
+	auto backup_function = m_Function;
+	m_Function = &info;
+
+	CreateReturn(GenIR(e.Body, e.Result), e.Location);
+	FinishFunction(*function, e.Location);
+
+	m_Function = backup_function;
+	Pop();
+	IRBuilder().SetInsertPoint(backup_block);
+	return RValue::Create(*this, function_type, function);
+}
+
+void tpp::Builder::CreateReturn(ValuePtr result, const SourceLocation &location)
+{
+	auto result_type = GenIR(m_Function->Result);
+	if (result_type->isVoidTy())
 	{
-		if (result->GetIRType() != result_type) result = CreateCast(result, e.Result);
-		IRBuilder().CreateRet(result->Get());
+		IRBuilder().CreateRetVoid();
+		return;
 	}
 
-	if (llvm::verifyFunction(*function, &llvm::errs()))
+	if (!result) error(location, "function must return a value");
+	if (result->GetIRType() != result_type) result = CreateCast(result, m_Function->Result);
+
+	auto result_abi = GetABI(m_Function->Result);
+	switch (result_abi.Kind)
 	{
-		function->print(llvm::errs());
-		error(e.Location, "failed to verify function");
+	case ABIKind_Direct: IRBuilder().CreateRet(result->Get()); break;
+
+	case ABIKind_Coerce:
+	{
+		auto slot = CreateCoercionSlot(result_type, result_abi.IRType);
+		IRBuilder().CreateStore(result->Get(), slot);
+		IRBuilder().CreateRet(IRBuilder().CreateLoad(result_abi.IRType, slot));
+		break;
 	}
 
-	Pop();
-	IRBuilder().SetInsertPoint(backup_block);
-	return RValue::Create(*this, function_type, function);
+	case ABIKind_Indirect:
+		IRBuilder().CreateStore(result->Get(), m_Function->Function->getArg(0));
+		IRBuilder().CreateRetVoid();
+		break;
+	}
 }
 
 tpp::ValuePtr tpp::Builder::GenIR(const DefVariableExpression &e)
 {
-	auto init = e.Init ? GenIR(e.Init) : nullptr;
+	// a call whose struct comes back in memory or registers has put it in a slot of its own already, which becomes the variable
+	auto call = e.Init ? e.Init->As<CallExpression>() : nullptr;
+	if (auto info = call && !call->IsSpawn && !IsGlobal() ? FindFunction(call->Callee) : nullptr)
+		if (GetABI(info->Result).Kind != ABIKind_Direct && (!e.Type || e.Type == info->Result))
+		{
+			auto slot = GenIR(e.Init);
+			Bind(e.MName, slot);
+			return slot;
+		}
+
+	auto init = e.Init ? GenIR(e.Init, e.Type) : nullptr;
 	auto type = e.Type ? e.Type : init->GetType();
 
 	return DefineVariable(e.MName, type, init);
 }
 
+tpp::ValuePtr tpp::Builder::GenIR(const ReturnExpression &e)
+{
+	// bodies of pfor and spawn are outlined into functions of their own, returning there would only end one iteration or task
+	if (!m_Function || IRBuilder().GetInsertBlock()->getParent() != m_Function->Function) error(e.Location, "return outside of a function body");
+
+	auto result = m_Function->Result->Kind == TypeKind_Void ? GenIR(e.Result) : GenIR(e.Result, m_Function->Result);
+	CreateReturn(result, e.Location);
+
+	// whatever follows up to the end of the enclosing group is dead
+	IRBuilder().SetInsertPoint(llvm::BasicBlock::Create(Context(), "return.dead", m_Function->Function));
+	return result;
+}
+
 tpp::ValuePtr tpp::Builder::GenIR(const ForExpression &e)
 {
 	Push();
 
-	auto from = GenIR(e.From);
-	auto to = GenIR(e.To);
-	ValuePtr step;
-
+	auto [from, to] = GenOperands(e.From, e.To);
 	auto counter_type = GetHigherOrder(from->GetType(), to->GetType());
+
+	ValuePtr step;
 	if (e.Step)
 	{
-		step = GenIR(e.Step);
+		step = GenIR(e.Step, counter_type);
 		counter_type = GetHigherOrder(counter_type, step->GetType());
 	}
-	else { step = RValue::Create(*this, counter_type, from->Get()); }
 
-	auto counter = LValue::Alloca(*this, counter_type, from);
-	if (!e.Id.empty()) m_Variables[e.Id] = counter;
+	auto ir_type = GenIR(counter_type);
+	if (!ir_type->isIntegerTy() && !ir_type->isFloatingPointTy()) error(e.Location, "loop counter must be a number: %s", counter_type->Name.c_str());
+	if (e.IsParallel && e.Step) error(e.Location, "pfor does not take a step");
+	if (e.IsParallel && !ir_type->isIntegerTy()) error(e.Location, "pfor counter must be an integer: %s", counter_type->Name.c_str());
 
-	auto function = IRBuilder().GetInsertBlock()->getParent();
-	auto condition_block = llvm::BasicBlock::Create(Context(), "condition", function);
-	auto loop_block = llvm::BasicBlock::Create(Context(), "loop", function);
-	auto end_block = llvm::BasicBlock::Create(Context(), "end", function);
+	// bounds and step are evaluated once, in front of the loop
+	auto load = [this, &counter_type](const ValuePtr &value) { return RValue::Create(*this, counter_type, CreateCast(value, counter_type)->Get()); };
+	from = load(from);
+	to = load(to);
+	step = step ? load(step) : RValue::Create(*this, counter_type, ir_type->isIntegerTy() ? llvm::ConstantInt::get(ir_type, 1) : llvm::ConstantFP::get(ir_type, 1.0));
 
-	IRBuilder().CreateBr(condition_block);
-	IRBuilder().SetInsertPoint(condition_block);
+	ValuePtr value;
+	if (e.IsParallel) CreateParallelFor(e, counter_type, from, to);
+	else value = CreateLoop(e, counter_type, from, to, step);
 
-	auto [lhs, rhs] = CreateHigherOrderCast(counter, to);
-	auto condition = CreateLT(lhs, rhs);
+	Pop();
+	return value;
+}
+
+tpp::ValuePtr tpp::Builder::CreateLoop(const ForExpression &e, const TypePtr &counter_type, const ValuePtr &from, const ValuePtr &to, const ValuePtr &step)
+{
+	auto ir_type = GenIR(counter_type);
 
-	IRBuilder().CreateCondBr(condition->Get(), loop_block, end_block);
+	// a rotated loop: the guard skips it entirely, the counter is a phi and the latch increments it and tests for the exit
+	auto function = IRBuilder().GetInsertBlock()->getParent();
+	auto preheader = IRBuilder().GetInsertBlock();
+	auto loop_block = llvm::BasicBlock::Create(Context(), "for.body", function);
+	auto end_block = llvm::BasicBlock::Create(Context(), "for.end", function);
+
+	IRBuilder().CreateCondBr(CreateLT(from, to)->Get(), loop_block, end_block);
 	IRBuilder().SetInsertPoint(loop_block);
 
+	auto counter = IRBuilder().CreatePHI(ir_type, 2, e.Id ? llvm::StringRef(e.Id.String()) : "for.counter");
+	counter->addIncoming(from->Get(), preheader);
+	// the counter is read-only in the body
+	if (e.Id) Bind(e.Id, RValue::Create(*this, counter_type, counter));
+
 	auto result = GenIR(e.Body);
+	auto last = result && !result->GetIRType()->isVoidTy() ? result->Get() : nullptr;
+
+	auto next = ir_type->isIntegerTy() ? IRBuilder().CreateNSWAdd(counter, step->Get(), "for.next") : IRBuilder().CreateFAdd(counter, step->Get(), "for.next");
+	counter->addIncoming(next, IRBuilder().GetInsertBlock());
+
+	auto condition = CreateLT(RValue::Create(*this, counter_type, next), to)->Get();
+	auto latch_block = IRBuilder().GetInsertBlock();
+	auto latch = IRBuilder().CreateCondBr(condition, loop_block, end_block);
+	if (auto metadata = CreateLoopMetadata(e.Hints)) latch->setMetadata(llvm::LLVMContext::MD_loop, metadata);
 
-	IRBuilder().CreateBr(end_block);
 	IRBuilder().SetInsertPoint(end_block);
+	return last ? CreateLoopResult(result->GetType(), last, preheader, latch_block) : nullptr;
+}
 
+void tpp::Builder::CreateParallelFor(const ForExpression &e, const TypePtr &counter_type, const ValuePtr &from, const ValuePtr &to)
+{
+	// everything local in scope is captured: variables by reference, so that iterations can write through them, values like an outer counter by copy
+	struct Capture
+	{
+		Name MName;
+		TypePtr MType;
+		llvm::Value *Field;
+		bool IsLValue;
+	};
+
+	std::vector<Capture> captures;
+	for (const auto &[name, value] : m_Variables)
+	{
+		auto lvalue = std::dynamic_pointer_cast<LValue>(value);
+		auto field = lvalue ? lvalue->GetPtr() : value->Get();
+		// globals and constants can be used from anywhere
+		if (llvm::isa<llvm::Constant>(field)) continue;
+		captures.push_back({ name, value->GetType(), field, lvalue != nullptr });
+	}
+
+	// the map is ordered by symbol ids, which depend on how files were parsed or loaded; sorted by name the context is the same for any -j and cache
+	std::sort(captures.begin(), captures.end(), [](const Capture &a, const Capture &b) { return a.MName.String() < b.MName.String(); });
+	std::vector<llvm::Type *> fields;
+	for (const auto &capture : captures) fields.push_back(capture.Field->getType());
+
+	auto context_type = llvm::StructType::get(Context(), fields);
+	auto context = CreateAlloca(context_type);
+	for (unsigned i = 0; i < captures.size(); ++i) IRBuilder().CreateStore(captures[i].Field, IRBuilder().CreateStructGEP(context_type, context, i));
+
+	// the body is outlined into a function that runs one chunk of iterations: void (ptr context, i64 begin, i64 end)
+	auto ptr_type = llvm::PointerType::get(Context(), 0);
+	auto i64_type = IRBuilder().getInt64Ty();
+	auto body_type = llvm::FunctionType::get(IRBuilder().getVoidTy(), { ptr_type, i64_type, i64_type }, false);
+	auto parent = IRBuilder().GetInsertBlock()->getParent();
+	auto body = llvm::Function::Create(body_type, llvm::Function::InternalLinkage, parent->getName() + ".pfor", Module());
+	body->getArg(0)->setName("context");
+	body->getArg(1)->setName("begin");
+	body->getArg(2)->setName("end");
+
+	auto backup_block = IRBuilder().GetInsertBlock();
+	IRBuilder().SetInsertPoint(llvm::BasicBlock::Create(Context(), "entry", body));
+
+	Push();
+	for (unsigned i = 0; i < captures.size(); ++i)
+	{
+		auto field = IRBuilder().CreateLoad(fields[i], IRBuilder().CreateStructGEP(context_type, body->getArg(0), i));
+		if (captures[i].IsLValue) Bind(captures[i].MName, LValue::Create(*this, captures[i].MType, field));
+		else Bind(captures[i].MName, RValue::Create(*this, captures[i].MType, field));
+	}
+
+	auto begin = CreateCast(RValue::Create(*this, Type::GetI64(), body->getArg(1)), counter_type);
+	auto end = CreateCast(RValue::Create(*this, Type::GetI64(), body->getArg(2)), counter_type);
+	CreateLoop(e, counter_type, begin, end, RValue::Create(*this, counter_type, llvm::ConstantInt::get(GenIR(counter_type), 1)));
+	IRBuilder().CreateRetVoid();
 	Pop();
-	return result;
+
+	FinishFunction(*body, e.Location);
+	IRBuilder().SetInsertPoint(backup_block);
+
+	auto runtime = Module().getOrInsertFunction("tpp_parallel_for", llvm::FunctionType::get(IRBuilder().getVoidTy(), { i64_type, i64_type, ptr_type, ptr_type }, false));
+	IRBuilder().CreateCall(runtime, { CreateCast(from, Type::GetI64())->Get(), CreateCast(to, Type::GetI64())->Get(), body, context });
+}
+
+tpp::ValuePtr tpp::Builder::GenIR(const WhileExpression &e)
+{
+	// rotated like 'for': the condition is tested in front of the loop and again in the latch
+	auto function = IRBuilder().GetInsertBlock()->getParent();
+	auto loop_block = llvm::BasicBlock::Create(Context(), "while.body", function);
+	auto end_block = llvm::BasicBlock::Create(Context(), "while.end", function);
+
+	auto condition = CreateCondition(e.Condition);
+	auto guard_block = IRBuilder().GetInsertBlock();
+	IRBuilder().CreateCondBr(condition, loop_block, end_block);
+	IRBuilder().SetInsertPoint(loop_block);
+
+	Push();
+	auto result = GenIR(e.Body);
+	auto last = result && !result->GetIRType()->isVoidTy() ? result->Get() : nullptr;
+	Pop();
+
+	condition = CreateCondition(e.Condition);
+	auto latch_block = IRBuilder().GetInsertBlock();
+	auto latch = IRBuilder().CreateCondBr(condition, loop_block, end_block);
+	if (auto metadata = CreateLoopMetadata(e.Hints)) latch->setMetadata(llvm::LLVMContext::MD_loop, metadata);
+
+	IRBuilder().SetInsertPoint(end_block);
+	return last ? CreateLoopResult(result->GetType(), last, guard_block, latch_block) : nullptr;
 }
 
-tpp::ValuePtr tpp::Builder::GenIR(const WhileExpression &e) { error(e.Location, "TODO"); }
+tpp::ValuePtr tpp::Builder::CreateLoopResult(const TypePtr &type, llvm::Value *last, llvm::BasicBlock *guard, llvm::BasicBlock *latch)
+{
+	// a loop yields the value of its last iteration, zero if it never ran
+	auto phi = IRBuilder().CreatePHI(last->getType(), 2);
+	phi->addIncoming(llvm::Constant::getNullValue(last->getType()), guard);
+	phi->addIncoming(last, latch);
+	return RValue::Create(*this, type, phi);
+}
 
 tpp::ValuePtr tpp::Builder::GenIR(const IfExpression &e) { error(e.Location, "TODO"); }
 
@@ -461,56 +1225,363 @@ tpp::ValuePtr tpp::Builder::GenIR(const GroupExpression &e)
 
 tpp::ValuePtr tpp::Builder::GenIR(const BinaryExpression &e)
 {
-	auto lhs = GenIR(e.Lhs);
-	auto rhs = GenIR(e.Rhs);
+	if (e.Operator == BinaryOp_LAnd || e.Operator == BinaryOp_LOr) return CreateLogical(e);
 
-	if (e.Operator == "=") { return CreateAssign(lhs, rhs); }
-	if (e.Operator == "===") { error(e.Location, "TODO"); }
+	auto [lhs, rhs] = GenOperands(e.Lhs, e.Rhs);
 
-	auto [left, right] = CreateHigherOrderCast(lhs, rhs);
+	if (e.Operator == BinaryOp_Assign) return CreateAssign(lhs, rhs);
 
-	ValuePtr result;
-	if (e.Operator == "<" && (result = CreateLT(left, right))) return result;
-	if (e.Operator == ">" && (result = CreateGT(left, right))) return result;
-	if (e.Operator == "<=" && (result = CreateLE(left, right))) return result;
-	if (e.Operator == ">=" && (result = CreateGE(left, right))) return result;
-	if (e.Operator == "==" && (result = CreateEQ(left, right))) return result;
-	if (e.Operator == "!=" && (result = CreateNE(left, right))) return result;
+	auto [left, right] = CreateHigherOrderCast(lhs, rhs);
 
-	auto pos = e.Operator.find("=");
-	bool assign = pos != std::string::npos;
-	auto op = assign ? e.Operator.substr(0, pos) : e.Operator;
+	// compound assignments compute their base operation and store the result back into lhs
+	const auto &info = GetInfo(e.Operator);
+	auto op = info.Base ? info.Base : e.Operator;
 
-	if (op == "+") { result = CreateAdd(left, right); }
-	else if (op == "-") { result = CreateSub(left, right); }
-	else if (op == "*") { result = CreateMul(left, right); }
-	else if (op == "/") { result = CreateDiv(left, right); }
-	else if (op == "%") { result = CreateRem(left, right); }
+	ValuePtr result;
+	switch (op)
+	{
+	case BinaryOp_LT: result = CreateLT(left, right); break;
+	case BinaryOp_GT: result = CreateGT(left, right); break;
+	case BinaryOp_LE: result = CreateLE(left, right); break;
+	case BinaryOp_GE: result = CreateGE(left, right); break;
+	case BinaryOp_EQ: result = CreateEQ(left, right); break;
+	case BinaryOp_NE: result = CreateNE(left, right); break;
+	case BinaryOp_And: result = CreateAnd(left, right); break;
+	case BinaryOp_Or: result = CreateOr(left, right); break;
+	case BinaryOp_Xor: result = CreateXor(left, right); break;
+	case BinaryOp_Shl: result = CreateShl(left, right); break;
+	case BinaryOp_AShr: result = CreateAShr(left, right); break;
+	case BinaryOp_LShr: result = CreateLShr(left, right); break;
+	case BinaryOp_Add: result = CreateAdd(left, right); break;
+	case BinaryOp_Sub: result = CreateSub(left, right); break;
+	case BinaryOp_Mul: result = CreateMul(left, right); break;
+	case BinaryOp_Div: result = CreateDiv(left, right); break;
+	case BinaryOp_Rem: result = CreateRem(left, right); break;
+	default: break;
+	}
 
-	if (!result) error(e.Location, "no such operation: %s %s %s", lhs->GetType()->Name.c_str(), e.Operator.c_str(), rhs->GetType()->Name.c_str());
+	if (!result) error(e.Location, "no such operation: %s %s %s", lhs->GetType()->Name.c_str(), info.Text.data(), rhs->GetType()->Name.c_str());
 
-	if (assign) { error(e.Location, "TODO"); }
+	if (info.Base) return CreateAssign(lhs, result);
 
 	return result;
 }
 
 tpp::ValuePtr tpp::Builder::GenIR(const CallExpression &e)
 {
-	auto function = Module().getFunction(e.Callee.String());
-	const auto &info = m_FunctionInfos[function];
+	auto found = FindFunction(e.Callee);
+	if (!found)
+	{
+		// functions of the program shadow the builtins
+		if (!e.IsSpawn)
+			if (auto result = CreateBuiltin(e)) return result;
+		error(e.Location, "no such function: %s", e.Callee.String().c_str());
+	}
+	const auto &info = *found;
+
+	std::vector<ValuePtr> args(e.Args.size());
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		if (i < info.Args.size())
+		{
+			args[i] = CreateCast(GenIR(e.Args[i], info.Args[i]), info.Args[i]);
+			continue;
+		}
+
+		// variadic arguments get the default promotions of c
+		auto value = GenIR(e.Args[i]);
+		auto ir_type = value->GetIRType();
+		if (ir_type->isIntegerTy(1)) value = RValue::Create(*this, Type::GetI32(), IRBuilder().CreateZExt(value->Get(), IRBuilder().getInt32Ty()));
+		else if (ir_type->isIntegerTy() && ir_type->getIntegerBitWidth() < 32) value = CreateCast(value, Type::GetI32());
+		else if (ir_type->isHalfTy() || ir_type->isFloatTy()) value = CreateCast(value, Type::GetF64());
+		args[i] = value;
+	}
+
+	if (e.IsSpawn) return CreateSpawn(e, info, args);
+	return CreateCall(info, args);
+}
+
+// memory nothing but the caller can reach, which a callee may read in place of a copy
+static bool is_private(llvm::Value *ptr)
+{
+	auto object = llvm::getUnderlyingObject(ptr);
+	if (llvm::isa<llvm::AllocaInst>(object)) return true;
+	auto arg = llvm::dyn_cast<llvm::Argument>(object);
+	return arg && arg->hasNoAliasAttr() && !arg->hasStructRetAttr();
+}
+
+tpp::ValuePtr tpp::Builder::CreateCall(const FunctionInfo &info, const std::vector<ValuePtr> &args, llvm::Value *result_slot)
+{
+	auto result_abi = GetABI(info.Result);
+	std::vector<llvm::Value *> ir_args;
+	if (result_abi.Kind == ABIKind_Indirect) ir_args.push_back(result_slot = result_slot ? result_slot : CreateAlloca(GenIR(info.Result)));
+
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		const auto &value = args[i];
+		auto abi = i < info.Args.size() ? GetABI(info.Args[i]) : ABIInfo{ ABIKind_Direct, value->GetIRType() };
+		switch (abi.Kind)
+		{
+		case ABIKind_Direct: ir_args.push_back(value->Get()); break;
+
+		case ABIKind_Coerce:
+		{
+			auto slot = CreateCoercionSlot(value->GetIRType(), abi.IRType);
+			IRBuilder().CreateStore(value->Get(), slot);
+			ir_args.push_back(IRBuilder().CreateLoad(abi.IRType, slot));
+			break;
+		}
+
+		case ABIKind_Indirect:
+		{
+			// byval makes its own copy, so any variable can be handed over as it is
+			if (auto lvalue = std::dynamic_pointer_cast<LValue>(value); lvalue && (info.IsExtern || is_private(lvalue->GetPtr())))
+			{
+				ir_args.push_back(lvalue->GetPtr());
+				break;
+			}
+
+			auto slot = CreateAlloca(value->GetIRType());
+			IRBuilder().CreateStore(value->Get(), slot);
+			ir_args.push_back(slot);
+			break;
+		}
+		}
+	}
+
+	auto call = IRBuilder().CreateCall(llvm::FunctionCallee(info.Function), ir_args);
+	call->setAttributes(info.Function->getAttributes());
+
+	switch (result_abi.Kind)
+	{
+	case ABIKind_Coerce:
+	{
+		auto slot = CreateCoercionSlot(GenIR(info.Result), result_abi.IRType);
+		IRBuilder().CreateStore(call, slot);
+		return LValue::Create(*this, info.Result, slot);
+	}
+
+	case ABIKind_Indirect: return LValue::Create(*this, info.Result, result_slot);
+
+	default: return RValue::Create(*this, info.Result, call);
+	}
+}
+
+tpp::ValuePtr tpp::Builder::CreateSpawn(const CallExpression &e, const FunctionInfo &info, const std::vector<ValuePtr> &args)
+{
+	// the task's frame holds the result first, so that sync finds it without knowing the call, followed by the arguments evaluated here
+	auto result_type = GenIR(info.Result);
+	std::vector<llvm::Type *> fields{ result_type->isVoidTy() ? IRBuilder().getInt8Ty() : result_type };
+	for (const auto &arg : args) fields.push_back(arg->GetIRType());
+	auto frame_type = llvm::StructType::get(Context(), fields);
+
+	// the call is outlined into a function that runs it out of the frame: void (ptr frame)
+	auto ptr_type = llvm::PointerType::get(Context(), 0);
+	auto body_type = llvm::FunctionType::get(IRBuilder().getVoidTy(), { ptr_type }, false);
+	auto parent = IRBuilder().GetInsertBlock()->getParent();
+	auto body = llvm::Function::Create(body_type, llvm::Function::InternalLinkage, parent->getName() + ".spawn", Module());
+	body->getArg(0)->setName("frame");
+	body->addParamAttr(0, llvm::Attribute::NoAlias);
+
+	auto backup_block = IRBuilder().GetInsertBlock();
+	IRBuilder().SetInsertPoint(llvm::BasicBlock::Create(Context(), "entry", body));
+
+	// the frame is the task's own, so a large argument or result is used right where it is
+	std::vector<ValuePtr> body_args(args.size());
+	for (unsigned i = 0; i < args.size(); ++i) body_args[i] = LValue::Create(*this, args[i]->GetType(), IRBuilder().CreateStructGEP(frame_type, body->getArg(0), i + 1));
+	auto result_slot = IRBuilder().CreateStructGEP(frame_type, body->getArg(0), 0);
+	auto result = CreateCall(info, body_args, GetABI(info.Result).Kind == ABIKind_Indirect ? result_slot : nullptr);
+	if (!result_type->isVoidTy() && GetABI(info.Result).Kind != ABIKind_Indirect) IRBuilder().CreateStore(result->Get(), result_slot);
+	IRBuilder().CreateRetVoid();
+
+	FinishFunction(*body, e.Location);
+	IRBuilder().SetInsertPoint(backup_block);
+
+	auto i64_type = IRBuilder().getInt64Ty();
+	auto alloc = Module().getOrInsertFunction("tpp_task_alloc", llvm::FunctionType::get(ptr_type, { ptr_type, i64_type }, false));
+	auto frame = IRBuilder().CreateCall(alloc, { body, llvm::ConstantExpr::getSizeOf(frame_type) });
+	for (unsigned i = 0; i < args.size(); ++i) IRBuilder().CreateStore(args[i]->Get(), IRBuilder().CreateStructGEP(frame_type, frame, i + 1));
+
+	auto spawn = Module().getOrInsertFunction("tpp_spawn", llvm::FunctionType::get(IRBuilder().getVoidTy(), { ptr_type }, false));
+	IRBuilder().CreateCall(spawn, { frame });
+	return RValue::Create(*this, Type::GetFuture(info.Result), frame);
+}
+
+tpp::ValuePtr tpp::Builder::CreateBuiltin(const CallExpression &e)
+{
+	auto name = e.Callee.String();
+	auto expect_args = [&e, &name](size_t count)
+	{
+		if (e.Args.size() != count) error(e.Location, "%s takes %zu arguments", name.c_str(), count);
+	};
+
+	if (name == "min" || name == "max")
+	{
+		expect_args(2);
+		auto [lhs, rhs] = GenOperands(e.Args[0], e.Args[1]);
+		auto [a, b] = CreateHigherOrderCast(lhs, rhs);
+		auto ir_type = a->GetIRType();
+
+		llvm::Intrinsic::ID id;
+		if (ir_type->isFPOrFPVectorTy()) id = name == "min" ? llvm::Intrinsic::minnum : llvm::Intrinsic::maxnum;
+		else if (ir_type->isIntOrIntVectorTy()) id = name == "min" ? llvm::Intrinsic::smin : llvm::Intrinsic::smax;
+		else error(e.Location, "no such operation: %s(%s, %s)", name.c_str(), lhs->GetType()->Name.c_str(), rhs->GetType()->Name.c_str());
+		return RValue::Create(*this, a->GetType(), IRBuilder().CreateBinaryIntrinsic(id, a->Get(), b->Get()));
+	}
+
+	if (name == "fma")
+	{
+		// a * b + c with a single rounding
+		expect_args(3);
+		auto [a, b] = GenOperands(e.Args[0], e.Args[1]);
+		auto c = GenIR(e.Args[2], a->GetType());
+		auto type = GetHigherOrder(GetHigherOrder(a->GetType(), b->GetType()), c->GetType());
+		auto ir_type = GenIR(type);
+		if (!ir_type->isFPOrFPVectorTy()) error(e.Location, "no such operation: fma(%s)", type->Name.c_str());
+		return RValue::Create(*this, type, IRBuilder().CreateIntrinsic(llvm::Intrinsic::fma, { ir_type }, { CreateCast(a, type)->Get(), CreateCast(b, type)->Get(), CreateCast(c, type)->Get() }));
+	}
+
+	if (name == "select")
+	{
+		// picks lanes of the second or third argument by a mask, or whole values by a scalar condition
+		expect_args(3);
+		auto mask = GenIR(e.Args[0]);
+		auto [lhs, rhs] = GenOperands(e.Args[1], e.Args[2]);
+		auto [a, b] = CreateHigherOrderCast(lhs, rhs);
+		auto condition = mask->GetIRType()->isVectorTy() && mask->GetType() == GetBoolType(a->GetType()) ? mask->Get() : CreateBool(mask);
+		if (!condition) error(e.Location, "no such operation: select(%s, %s)", mask->GetType()->Name.c_str(), a->GetType()->Name.c_str());
+		return RValue::Create(*this, a->GetType(), IRBuilder().CreateSelect(condition, a->Get(), b->Get()));
+	}
+
+	if (name == "shuffle")
+	{
+		// shuffle(a, lanes...) rearranges the lanes of a, shuffle(a, b, lanes...) picks from both with the lanes of b numbered after those of a
+		if (e.Args.size() < 2) error(e.Location, "shuffle takes a vector and lanes");
+		auto a = GenIR(e.Args[0]);
+		auto type = a->GetType()->As<VectorType>();
+		if (!type) error(e.Location, "cannot shuffle non-vector type: %s", a->GetType()->Name.c_str());
+
+		ValuePtr b;
+		size_t first = 1;
+		if (!e.Args[1]->As<NumberExpression>()) b = CreateCast(GenIR(e.Args[1], a->GetType()), a->GetType()), first = 2;
+
+		auto lanes = b ? 2 * type->Count : type->Count;
+		std::vector<int> mask;
+		for (size_t i = first; i < e.Args.size(); ++i)
+		{
+			auto lane = e.Args[i]->As<NumberExpression>();
+			if (!lane || !lane->IsInteger || lane->Integer < 0 || lane->Integer >= lanes) error(e.Args[i]->Location, "shuffle lanes must be constants below %u", lanes);
+			mask.push_back((int) lane->Integer);
+		}
+		if (mask.empty()) error(e.Location, "shuffle takes a vector and lanes");
+
+		auto result = b ? IRBuilder().CreateShuffleVector(a->Get(), b->Get(), mask) : IRBuilder().CreateShuffleVector(a->Get(), mask);
+		return RValue::Create(*this, mask.size() == 1 ? type->Base : Type::GetVector(type->Base, (unsigned) mask.size()), mask.size() == 1 ? IRBuilder().CreateExtractElement(result, uint64_t(0)) : result);
+	}
+
+	if (name.rfind("reduce_", 0) == 0)
+	{
+		// horizontal operations over all lanes of a vector
+		expect_args(1);
+		auto value = GenIR(e.Args[0]);
+		auto type = value->GetType()->As<VectorType>();
+		if (!type) error(e.Location, "cannot reduce non-vector type: %s", value->GetType()->Name.c_str());
+
+		auto op = name.substr(7);
+		auto src = value->Get();
+		auto scalar = value->GetIRType()->getScalarType();
+		bool is_float = scalar->isFloatingPointTy();
+
+		llvm::Value *result = nullptr;
+		if (op == "add") result = is_float ? IRBuilder().CreateFAddReduce(llvm::ConstantFP::get(scalar, -0.0), src) : IRBuilder().CreateAddReduce(src);
+		else if (op == "mul") result = is_float ? IRBuilder().CreateFMulReduce(llvm::ConstantFP::get(scalar, 1.0), src) : IRBuilder().CreateMulReduce(src);
+		else if (op == "min") result = is_float ? IRBuilder().CreateFPMinReduce(src) : IRBuilder().CreateIntMinReduce(src, true);
+		else if (op == "max") result = is_float ? IRBuilder().CreateFPMaxReduce(src) : IRBuilder().CreateIntMaxReduce(src, true);
+		else if (op == "and" && !is_float) result = IRBuilder().CreateAndReduce(src);
+		else if (op == "or" && !is_float) result = IRBuilder().CreateOrReduce(src);
+		else error(e.Location, "no such operation: %s(%s)", name.c_str(), type->Name.c_str());
+
+		// without reassociation a floating point reduction runs lane after lane instead of as a tree
+		if (is_float) llvm::cast<llvm::Instruction>(result)->setHasAllowReassoc(true);
+		return RValue::Create(*this, type->Base, result);
+	}
+
+	return nullptr;
+}
+
+tpp::ValuePtr tpp::Builder::CreateElements(const ObjectExpression &e, const TypePtr &type)
+{
+	auto [element, count] = get_elements(type);
+	if (e.Init.size() == 1) return CreateCast(GenIR(e.Init[0], element), type);
+	if (e.Init.size() != count) error(e.Location, "expected %u elements for %s, got %zu", count, type->Name.c_str(), e.Init.size());
 
-	std::vector<llvm::Value *> args(e.Args.size());
-	for (size_t i = 0; i < args.size(); ++i) args[i] = GenIR(e.Args[i])->Get();
+	bool is_vector = type->Kind == TypeKind_Vector;
+	llvm::Value *result = llvm::PoisonValue::get(GenIR(type));
+	for (unsigned i = 0; i < count; ++i)
+	{
+		auto value = CreateCast(GenIR(e.Init[i], element), element)->Get();
+		result = is_vector ? IRBuilder().CreateInsertElement(result, value, uint64_t(i)) : IRBuilder().CreateInsertValue(result, value, i);
+	}
+	return RValue::Create(*this, type, result);
+}
+
+tpp::ValuePtr tpp::Builder::CreateElement(const IndexExpression &e, const ValuePtr &array, const ValuePtr &index)
+{
+	auto type = array->GetType()->As<FixedArrayType>();
+
+	// the length is part of the type, so constant indices are checked right away
+	auto constant = llvm::dyn_cast<llvm::ConstantInt>(index->Get());
+	if (constant && (constant->getSExtValue() < 0 || constant->getSExtValue() >= type->Count))
+		error(e.Location, "index %lld is out of bounds for %s", (long long) constant->getSExtValue(), type->Name.c_str());
+
+	if (auto lvalue = std::dynamic_pointer_cast<LValue>(array))
+		return LValue::Create(*this, type->Base, IRBuilder().CreateInBoundsGEP(array->GetIRType(), lvalue->GetPtr(), { IRBuilder().getInt64(0), index->Get() }));
+	if (constant) return RValue::Create(*this, type->Base, IRBuilder().CreateExtractValue(array->Get(), (unsigned) constant->getZExtValue()));
+
+	// a value has to be in memory to take a dynamic index
+	auto ptr = CreateAlloca(array->GetIRType());
+	IRBuilder().CreateStore(array->Get(), ptr);
+	auto element = IRBuilder().CreateInBoundsGEP(array->GetIRType(), ptr, { IRBuilder().getInt64(0), index->Get() });
+	return RValue::Create(*this, type->Base, IRBuilder().CreateLoad(GenIR(type->Base), element));
+}
+
+tpp::ValuePtr tpp::Builder::CreateLane(const ValuePtr &vector, llvm::Value *lane)
+{
+	auto type = vector->GetType()->As<VectorType>();
 
-	return RValue::Create(*this, info.Result, IRBuilder().CreateCall(llvm::FunctionCallee(function), args));
+	// lanes of a vector in memory can be assigned to, except for masks whose lanes are packed into bits
+	auto lvalue = std::dynamic_pointer_cast<LValue>(vector);
+	if (lvalue && type->Base->Kind != TypeKind_I1) return LValue::Create(*this, type->Base, IRBuilder().CreateInBoundsGEP(vector->GetIRType(), lvalue->GetPtr(), { IRBuilder().getInt64(0), lane }));
+	return RValue::Create(*this, type->Base, IRBuilder().CreateExtractElement(vector->Get(), lane));
+}
+
+tpp::ValuePtr tpp::Builder::CreateSwizzle(const MemberExpression &e, const ValuePtr &vector)
+{
+	// x, y, z and w name the first four lanes; more of them pick those lanes in order, like v.zyx or v.xxxx
+	auto type = vector->GetType()->As<VectorType>();
+	auto member = std::string(e.Member.String());
+
+	std::vector<int> lanes;
+	for (auto c : member)
+	{
+		auto lane = std::string_view("xyzw").find(c);
+		if (lane == std::string_view::npos || lane >= type->Count) error(e.Location, "no such member: %s.%s", type->Name.c_str(), member.c_str());
+		lanes.push_back((int) lane);
+	}
+
+	if (lanes.size() == 1) return CreateLane(vector, IRBuilder().getInt64(lanes[0]));
+	return RValue::Create(*this, Type::GetVector(type->Base, (unsigned) lanes.size()), IRBuilder().CreateShuffleVector(vector->Get(), lanes));
 }
 
 tpp::ValuePtr tpp::Builder::GenIR(const IndexExpression &e)
 {
 	auto array = GenIR(e.Array);
-	auto index = CreateCast(GenIR(e.Index), Type::GetI64());
+	auto index = CreateCast(GenIR(e.Index, Type::GetI64()), Type::GetI64());
 
-	auto array_type = std::dynamic_pointer_cast<ArrayType>(array->GetType());
+	if (array->GetType()->Kind == TypeKind_Vector) return CreateLane(array, index->Get());
+	if (array->GetType()->Kind == TypeKind_FixedArray) return CreateElement(e, array, index);
+
+	auto array_type = array->GetType()->As<ArrayType>();
 	if (!array_type) error(e.Location, "cannot index into non-array type: %s", array->GetType()->Name.c_str());
 	auto element_type = array_type->Base;
 
@@ -522,22 +1593,48 @@ tpp::ValuePtr tpp::Builder::GenIR(const MemberExpression &e)
 {
 	auto object = GenIR(e.Object);
 
-	if (e.Member == "string") error(e.Location, "TODO");
+	if (object->GetType()->Kind == TypeKind_Vector) return CreateSwizzle(e, object);
+
+	// placeholders left by concurrent parsing mean whatever the name is bound to by now
+	auto type = object->GetType();
+	if (type->Kind == TypeKind_Named) type = Type::Get(Symbol::Get(type->Name), true);
+
+	if (auto struct_type = type->As<StructType>())
+		for (unsigned i = 0; i < struct_type->Elements.size(); ++i)
+		{
+			const auto &element = struct_type->Elements[i];
+			if (!(element.MName == Name(e.Member))) continue;
+
+			if (auto lvalue = std::dynamic_pointer_cast<LValue>(object)) return LValue::Create(*this, element.MType, IRBuilder().CreateStructGEP(object->GetIRType(), lvalue->GetPtr(), i));
+			return RValue::Create(*this, element.MType, IRBuilder().CreateExtractValue(object->Get(), i));
+		}
+
+	if (auto fixed = type->As<FixedArrayType>(); fixed && e.Member.String() == "size") return RValue::Create(*this, Type::GetI64(), IRBuilder().getInt64(fixed->Count));
+
+	if (e.Member.String() == "string") error(e.Location, "TODO");
 
-	if (auto t = std::dynamic_pointer_cast<ArrayType>(object->GetType()))
+	if (object->GetType()->Kind == TypeKind_Array)
 	{
-		if (e.Member == "size") error(e.Location, "TODO");
+		if (e.Member.String() == "size") error(e.Location, "TODO");
 	}
 
-	error(e.Location, "no such member: %s.%s", object->GetType()->Name.c_str(), e.Member.c_str());
+	error(e.Location, "no such member: %s.%s", object->GetType()->Name.c_str(), std::string(e.Member.String()).c_str());
 }
 
-tpp::ValuePtr tpp::Builder::GenIR(const IDExpression &e) { return m_Variables[e.MName.String()]; }
+tpp::ValuePtr tpp::Builder::GenIR(const IDExpression &e)
+{
+	auto it = m_Variables.find(e.MName);
+	if (it == m_Variables.end()) error(e.Location, "no such variable: %s", e.MName.String().c_str());
+
+	// locals are always visible, a global only if it was declared before the body being lowered
+	auto lvalue = std::dynamic_pointer_cast<LValue>(it->second);
+	if (lvalue && llvm::isa<llvm::GlobalVariable>(lvalue->GetPtr()) && !IsDeclared(e.MName)) error(e.Location, "no such variable: %s", e.MName.String().c_str());
+	return it->second;
+}
 
 tpp::ValuePtr tpp::Builder::GenIR(const NumberExpression &e)
 {
-	auto value = llvm::ConstantFP::get(GenIR(e.GetType()), e.Value);
-	return RValue::Create(*this, e.GetType(), value);
+	return CreateNumber(e, e.GetType());
 }
 
 tpp::ValuePtr tpp::Builder::GenIR(const CharExpression &e) { error(e.Location, "TODO"); }
@@ -556,6 +1653,25 @@ tpp::ValuePtr tpp::Builder::GenIR(const ObjectExpression &e) { error(e.Location,
 
 tpp::ValuePtr tpp::Builder::GenIR(const ArrayExpression &e) { error(e.Location, "TODO"); }
 
+tpp::ValuePtr tpp::Builder::GenIR(const SyncExpression &e)
+{
+	auto future = GenIR(e.Future);
+	auto type = future ? future->GetType()->As<FutureType>() : nullptr;
+	if (!type) error(e.Location, "sync expects the future of a spawned call");
+
+	auto frame = future->Get();
+	auto ptr_type = llvm::PointerType::get(Context(), 0);
+	auto sync = Module().getOrInsertFunction("tpp_sync", llvm::FunctionType::get(IRBuilder().getVoidTy(), { ptr_type }, false));
+	IRBuilder().CreateCall(sync, { frame });
+
+	// the task goes away with this, a future is synced once
+	ValuePtr result;
+	if (type->Base->Kind != TypeKind_Void) result = RValue::Create(*this, type->Base, IRBuilder().CreateLoad(GenIR(type->Base), frame));
+	auto free = Module().getOrInsertFunction("tpp_task_free", llvm::FunctionType::get(IRBuilder().getVoidTy(), { ptr_type }, false));
+	IRBuilder().CreateCall(free, { frame });
+	return result;
+}
+
 const char *tpp::Builder::TypeToString(llvm::Type *type)
 {
 	switch (type->getTypeID())
@@ -585,3 +1701,4 @@ const char *tpp::Builder::TypeToString(llvm::Type *type)
 	default: error(SourceLocation::UNKNOWN, "missing switch case");
 	}
 }
+
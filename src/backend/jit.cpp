@@ -0,0 +1,72 @@
+#include <TPP/Backend/JIT.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <TPP/Runtime/Runtime.hpp>
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/Orc/Shared/ExecutorSymbolDef.h>
+#include <llvm/ExecutionEngine/Orc/TargetProcess/TargetExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/Support/Error.h>
+
+template <typename T>
+static T unwrap(llvm::Expected<T> expected, const char *what)
+{
+	if (!expected) tpp::error(tpp::SourceLocation::UNKNOWN, "%s: %s", what, llvm::toString(expected.takeError()).c_str());
+	return std::move(*expected);
+}
+
+static void unwrap(llvm::Error err, const char *what)
+{
+	if (err) tpp::error(tpp::SourceLocation::UNKNOWN, "%s: %s", what, llvm::toString(std::move(err)).c_str());
+}
+
+tpp::JIT::JIT(OptLevel level)
+{
+	auto machine_builder = unwrap(llvm::orc::JITTargetMachineBuilder::detectHost(), "failed to detect host");
+	machine_builder.setCodeGenOptLevel(GetCodeGenLevel(level));
+
+	m_JIT = unwrap(
+		llvm::orc::LLJITBuilder()
+			.setJITTargetMachineBuilder(std::move(machine_builder))
+			.setObjectLinkingLayerCreator(
+				[](llvm::orc::ExecutionSession &session, const llvm::Triple &)
+				{
+					auto layer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(session, []() { return std::make_unique<llvm::SectionMemoryManager>(); });
+					layer->registerJITEventListener(*llvm::JITEventListener::createGDBRegistrationListener());
+					if (auto perf = llvm::JITEventListener::createPerfJITEventListener()) layer->registerJITEventListener(*perf);
+					return layer;
+				})
+			.create(),
+		"failed to create jit");
+
+	auto &dylib = m_JIT->getMainJITDylib();
+	auto generator = unwrap(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(m_JIT->getDataLayout().getGlobalPrefix()), "failed to create host symbol generator");
+	dylib.addGenerator(std::move(generator));
+
+	// the runtime is linked into the compiler itself
+	llvm::orc::SymbolMap runtime;
+	runtime[m_JIT->mangleAndIntern("tpp_parallel_for")] = { llvm::orc::ExecutorAddr::fromPtr(&tpp_parallel_for), llvm::JITSymbolFlags::Exported };
+	runtime[m_JIT->mangleAndIntern("tpp_task_alloc")] = { llvm::orc::ExecutorAddr::fromPtr(&tpp_task_alloc), llvm::JITSymbolFlags::Exported };
+	runtime[m_JIT->mangleAndIntern("tpp_spawn")] = { llvm::orc::ExecutorAddr::fromPtr(&tpp_spawn), llvm::JITSymbolFlags::Exported };
+	runtime[m_JIT->mangleAndIntern("tpp_sync")] = { llvm::orc::ExecutorAddr::fromPtr(&tpp_sync), llvm::JITSymbolFlags::Exported };
+	runtime[m_JIT->mangleAndIntern("tpp_task_free")] = { llvm::orc::ExecutorAddr::fromPtr(&tpp_task_free), llvm::JITSymbolFlags::Exported };
+	unwrap(dylib.define(llvm::orc::absoluteSymbols(std::move(runtime))), "failed to define runtime symbols");
+}
+
+void tpp::JIT::Add(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module)
+{
+	unwrap(m_JIT->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))), "failed to add module");
+}
+
+int tpp::JIT::Run(const std::string &program, const std::vector<std::string> &args)
+{
+	auto global = unwrap(m_JIT->lookup(".global"), "failed to lookup global initializer");
+	global.toPtr<void (*)()>()();
+
+	auto main = unwrap(m_JIT->lookup("main"), "failed to lookup main");
+	return llvm::orc::runAsMain(main.toPtr<int (*)(int, char **)>(), args, llvm::StringRef(program));
+}
@@ -0,0 +1,80 @@
+#include <TPP/Backend/ObjectCache.hpp>
+#include <TPP/Backend/Optimizer.hpp>
+#include <TPP/Frontend/DependencyGraph.hpp>
+#include <cstdio>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+#include <string>
+
+// bump whenever codegen changes in a way that invalidates existing entries
+static constexpr unsigned VERSION = 4;
+
+// a rebuilt compiler can lower the same source differently without anyone bumping VERSION, so its binary is part of the key as well
+static std::string build_id()
+{
+	auto path = llvm::sys::fs::getMainExecutable(nullptr, (void *) &build_id);
+	llvm::sys::fs::file_status status;
+	if (path.empty() || llvm::sys::fs::status(path, status)) return {};
+	return std::to_string(status.getSize()) + ':' + std::to_string(status.getLastModificationTime().time_since_epoch().count());
+}
+
+tpp::ObjectCache::ObjectCache(const std::filesystem::path &directory, const DependencyGraph &graph, OptLevel level, const std::string &passes, const llvm::Module &module)
+	: m_Directory(directory), m_Graph(graph)
+{
+	llvm::sys::fs::create_directories(directory.string());
+
+	llvm::raw_string_ostream stream(m_Options);
+	stream << VERSION << '\0' << build_id() << '\0' << level << '\0' << passes << '\0' << module.getTargetTriple() << '\0' << module.getDataLayoutStr() << '\0';
+}
+
+std::unique_ptr<llvm::MemoryBuffer> tpp::ObjectCache::Load(const std::string &filepath)
+{
+	auto buffer = llvm::MemoryBuffer::getFile(EntryPath(filepath).string(), false, false);
+	return buffer ? std::move(*buffer) : nullptr;
+}
+
+void tpp::ObjectCache::Store(const std::string &filepath, llvm::StringRef bitcode)
+{
+	// written next to the entry and renamed, so a concurrent build never loads a partial file
+	auto entry = EntryPath(filepath).string();
+	int fd;
+	llvm::SmallString<128> temp;
+	if (llvm::sys::fs::createUniqueFile(entry + ".%%%%%%.tmp", fd, temp)) return;
+	{
+		llvm::raw_fd_ostream stream(fd, true);
+		stream << bitcode;
+	}
+	if (llvm::sys::fs::rename(temp, entry)) llvm::sys::fs::remove(temp);
+}
+
+std::filesystem::path tpp::ObjectCache::EntryPath(const std::string &filepath)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bc", (unsigned long long) Key(filepath));
+	return m_Directory / name;
+}
+
+uint64_t tpp::ObjectCache::Key(const std::string &filepath)
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		if (auto it = m_Keys.find(filepath); it != m_Keys.end()) return it->second;
+	}
+
+	// the file itself, and only the interfaces of what it can see: editing a body elsewhere keeps this entry
+	// declarations delivered earlier are visible without an include, so those files count as well; later ones are not, since a deferred body is
+	// limited to the declarations made before it, and ParallelBuilder still checks the types a loaded entry refers to before linking it
+	std::string data = m_Options + filepath + '\0';
+	if (auto buffer = llvm::MemoryBuffer::getFile(filepath, false, false)) data += (*buffer)->getBuffer();
+	for (const auto &visible : m_Graph.Visible(filepath))
+	{
+		auto value = m_Graph.Interface(visible);
+		data.append((const char *) &value, sizeof(value));
+	}
+
+	auto key = llvm::xxHash64(data);
+	std::lock_guard lock(m_Mutex);
+	return m_Keys[filepath] = key;
+}
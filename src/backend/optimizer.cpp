@@ -0,0 +1,114 @@
+#include <TPP/Backend/Optimizer.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Profiler.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/TimeProfiler.h>
+
+static llvm::OptimizationLevel to_llvm(tpp::OptLevel level)
+{
+	switch (level)
+	{
+	case tpp::OptLevel_O0: return llvm::OptimizationLevel::O0;
+	case tpp::OptLevel_O1: return llvm::OptimizationLevel::O1;
+	case tpp::OptLevel_O2: return llvm::OptimizationLevel::O2;
+	case tpp::OptLevel_O3: return llvm::OptimizationLevel::O3;
+	default: tpp::error(tpp::SourceLocation::UNKNOWN, "missing switch case");
+	}
+}
+
+llvm::CodeGenOpt::Level tpp::GetCodeGenLevel(OptLevel level)
+{
+	switch (level)
+	{
+	case OptLevel_O0: return llvm::CodeGenOpt::None;
+	case OptLevel_O1: return llvm::CodeGenOpt::Less;
+	case OptLevel_O2: return llvm::CodeGenOpt::Default;
+	case OptLevel_O3: return llvm::CodeGenOpt::Aggressive;
+	default: error(SourceLocation::UNKNOWN, "missing switch case");
+	}
+}
+
+static llvm::PipelineTuningOptions tuning_options(tpp::OptLevel level)
+{
+	// like clang, the vectorizers run on their own from -O2 on; below that only loops with a '@vectorize' hint are vectorized
+	llvm::PipelineTuningOptions options;
+	options.LoopVectorization = level >= tpp::OptLevel_O2;
+	options.SLPVectorization = level >= tpp::OptLevel_O2;
+	return options;
+}
+
+static bool is_special(llvm::StringRef pass) { return llvm::isSpecialPass(pass, { "PassManager", "PassAdaptor", "AnalysisManagerProxy" }); }
+
+tpp::Optimizer::Optimizer(OptLevel level, const std::string &passes, llvm::TargetMachine *machine)
+	: m_Level(level), m_Passes(passes), m_PB(machine, tuning_options(level), std::nullopt, &m_PIC)
+{
+	if (Profiler::Global().Report() || Profiler::Global().Trace())
+	{
+		m_PIC.registerBeforeNonSkippedPassCallback([this](llvm::StringRef pass, llvm::Any) { BeginPass(pass); });
+		m_PIC.registerAfterPassCallback([this](llvm::StringRef pass, llvm::Any, const llvm::PreservedAnalyses &) { EndPass(pass); });
+		m_PIC.registerAfterPassInvalidatedCallback([this](llvm::StringRef pass, const llvm::PreservedAnalyses &) { EndPass(pass); });
+	}
+
+	m_PB.registerModuleAnalyses(m_MAM);
+	m_PB.registerCGSCCAnalyses(m_CGAM);
+	m_PB.registerFunctionAnalyses(m_FAM);
+	m_PB.registerLoopAnalyses(m_LAM);
+	m_PB.crossRegisterProxies(m_LAM, m_FAM, m_CGAM, m_MAM);
+
+	if (!m_Passes.empty())
+	{
+		if (auto err = m_PB.parsePassPipeline(m_MPM, m_Passes)) error(SourceLocation::UNKNOWN, "invalid pass pipeline '%s': %s", m_Passes.c_str(), llvm::toString(std::move(err)).c_str());
+		return;
+	}
+
+	if (m_Level == OptLevel_O0)
+	{
+		m_MPM = m_PB.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+		return;
+	}
+
+	m_FPM = m_PB.buildFunctionSimplificationPipeline(to_llvm(m_Level), llvm::ThinOrFullLTOPhase::None);
+	m_MPM = m_PB.buildPerModuleDefaultPipeline(to_llvm(m_Level));
+}
+
+tpp::OptLevel tpp::Optimizer::Level() const { return m_Level; }
+
+void tpp::Optimizer::Run(llvm::Function &function)
+{
+	if (m_FPM.isEmpty() || function.isDeclaration()) return;
+	m_FPM.run(function, m_FAM);
+}
+
+void tpp::Optimizer::BeginPass(llvm::StringRef pass)
+{
+	if (is_special(pass)) return;
+
+	auto now = std::chrono::steady_clock::now();
+	if (!m_Running.empty()) Profiler::Global().AddPass(m_Running.back().first, now - m_Running.back().second, 0);
+	m_Running.emplace_back(pass, now);
+
+	if (llvm::timeTraceProfilerEnabled()) llvm::timeTraceProfilerBegin(pass, llvm::StringRef());
+}
+
+void tpp::Optimizer::EndPass(llvm::StringRef pass)
+{
+	if (is_special(pass) || m_Running.empty()) return;
+
+	auto now = std::chrono::steady_clock::now();
+	Profiler::Global().AddPass(m_Running.back().first, now - m_Running.back().second, 1);
+	m_Running.pop_back();
+	if (!m_Running.empty()) m_Running.back().second = now;
+
+	if (llvm::timeTraceProfilerEnabled()) llvm::timeTraceProfilerEnd();
+}
+
+void tpp::Optimizer::Run(llvm::Module &module)
+{
+	m_LAM.clear();
+	m_FAM.clear();
+	m_CGAM.clear();
+	m_MAM.clear();
+	m_MPM.run(module, m_MAM);
+}
@@ -0,0 +1,167 @@
+#include <TPP/Backend/Builder.hpp>
+#include <TPP/Backend/ObjectCache.hpp>
+#include <TPP/Backend/Optimizer.hpp>
+#include <TPP/Backend/ParallelBuilder.hpp>
+#include <TPP/Backend/Target.hpp>
+#include <TPP/Frontend/Expression.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Profiler.hpp>
+#include <algorithm>
+#include <atomic>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/MemoryBufferRef.h>
+#include <llvm/Support/raw_ostream.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// chunking only depends on the program, so the linked module is the same for any number of jobs
+static constexpr size_t CHUNK_SIZE = 16;
+
+namespace
+{
+	struct Chunk
+	{
+		std::string Name;
+		std::vector<tpp::DeferredBody> Bodies;
+		llvm::SmallVector<char, 0> Bitcode;
+		std::unique_ptr<llvm::MemoryBuffer> Cached;
+	};
+}
+
+// a cached chunk only fits if everything it refers to still has the type it was lowered against; a mismatch would link silently
+static bool matches(const llvm::MemoryBuffer &buffer, const llvm::Module &module)
+{
+	auto context = std::make_unique<llvm::LLVMContext>();
+	auto cached = llvm::getLazyBitcodeModule(buffer.getMemBufferRef(), *context);
+	if (!cached)
+	{
+		llvm::consumeError(cached.takeError());
+		return false;
+	}
+
+	auto print = [](llvm::Type *type)
+	{
+		std::string result;
+		llvm::raw_string_ostream stream(result);
+		type->print(stream);
+		return result;
+	};
+
+	for (const auto &function : **cached)
+		if (auto current = module.getFunction(function.getName()); current && print(current->getFunctionType()) != print(function.getFunctionType())) return false;
+	for (const auto &global : (*cached)->globals())
+		if (auto current = module.getNamedGlobal(global.getName()); current && print(current->getValueType()) != print(global.getValueType())) return false;
+	return true;
+}
+
+tpp::ParallelBuilder::ParallelBuilder(Builder &builder, OptLevel level, const std::string &passes, unsigned jobs, ObjectCache *cache)
+	: m_Builder(builder), m_Level(level), m_Passes(passes), m_Jobs(jobs ? jobs : std::max(1u, std::thread::hardware_concurrency())), m_Cache(cache)
+{
+}
+
+void tpp::ParallelBuilder::GenIR(const ExprPtr &ptr)
+{
+	ProfileScope scope(ProfilePhase_GenIR, [&ptr] { return ptr->Location.Filepath->string() + ":" + std::to_string(ptr->Location.Row); });
+
+	auto def = ptr->As<DefFunctionExpression>();
+	if (!def || !def->Body)
+	{
+		m_Builder.GenIR(ptr);
+		return;
+	}
+
+	if (!m_Defined.insert(def->MName).second) error(def->Location, "function cannot be redefined");
+
+	m_Builder.DeclareFunction(*def);
+	m_Bodies.push_back({ ptr, m_Builder.Declarations() });
+}
+
+void tpp::ParallelBuilder::Finish()
+{
+	std::vector<Chunk> chunks;
+	if (m_Cache)
+	{
+		// one chunk per source file, in order of its first body
+		std::unordered_map<std::string, size_t> files;
+		for (const auto &body : m_Bodies)
+		{
+			auto [it, inserted] = files.emplace(body.Body->Location.Filepath->string(), chunks.size());
+			if (inserted) chunks.emplace_back().Name = it->first;
+			chunks[it->second].Bodies.push_back(body);
+		}
+
+		for (auto &chunk : chunks)
+			if ((chunk.Cached = m_Cache->Load(chunk.Name)) && !matches(*chunk.Cached, m_Builder.Module())) chunk.Cached.reset();
+	}
+	else
+	{
+		for (size_t i = 0; i < m_Bodies.size(); i += CHUNK_SIZE)
+		{
+			auto &chunk = chunks.emplace_back();
+			chunk.Name = "chunk." + std::to_string(chunks.size() - 1);
+			chunk.Bodies.assign(m_Bodies.begin() + i, m_Bodies.begin() + std::min(m_Bodies.size(), i + CHUNK_SIZE));
+		}
+	}
+
+	std::vector<Chunk *> pending;
+	for (auto &chunk : chunks)
+		if (!chunk.Cached) pending.push_back(&chunk);
+
+	std::atomic<size_t> next = 0;
+
+	auto work = [&]
+	{
+		ProfileThread thread;
+		Target target(m_Level);
+		Optimizer optimizer(m_Level, m_Passes, &target.Machine());
+
+		for (size_t i; (i = next++) < pending.size();)
+		{
+			auto &chunk = *pending[i];
+			Builder builder(m_Builder, &optimizer);
+			for (const auto &body : chunk.Bodies)
+			{
+				builder.LimitDeclarations(body.Declarations);
+				builder.GenIR(body.Body);
+			}
+
+			// keep only what the bodies reference, so a cached chunk does not bring back declarations that are gone
+			for (auto &function : llvm::make_early_inc_range(builder.Module()))
+				if (function.isDeclaration() && function.use_empty()) function.eraseFromParent();
+			for (auto &global : llvm::make_early_inc_range(builder.Module().globals()))
+				if (global.isDeclaration() && global.use_empty()) global.eraseFromParent();
+
+			llvm::raw_svector_ostream stream(chunk.Bitcode);
+			// with the use lists in their original order, later passes visit users the same way as in a serial build
+			llvm::WriteBitcodeToFile(builder.Module(), stream, true);
+
+			if (m_Cache) m_Cache->Store(chunk.Name, llvm::StringRef(chunk.Bitcode.data(), chunk.Bitcode.size()));
+		}
+	};
+
+	std::vector<std::thread> threads;
+	auto workers = std::min<size_t>(m_Jobs, pending.size());
+	for (size_t i = 1; i < workers; ++i) threads.emplace_back(work);
+	if (!pending.empty()) work();
+	for (auto &thread : threads) thread.join();
+
+	std::vector<llvm::MemoryBufferRef> modules;
+	for (const auto &chunk : chunks)
+	{
+		if (chunk.Cached) modules.emplace_back(chunk.Cached->getBuffer(), chunk.Name);
+		else modules.emplace_back(llvm::StringRef(chunk.Bitcode.data(), chunk.Bitcode.size()), chunk.Name);
+	}
+
+	m_Builder.Link(modules);
+	m_Bodies.clear();
+}
@@ -0,0 +1,80 @@
+#include <TPP/Backend/Target.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Host.h>
+
+void tpp::Target::Init()
+{
+	llvm::InitializeNativeTarget();
+	llvm::InitializeNativeTargetAsmPrinter();
+}
+
+void tpp::Target::Link(const std::vector<std::string> &objects, const std::string &filename)
+{
+	auto linker = llvm::sys::findProgramByName("cc");
+	if (!linker) error(SourceLocation::UNKNOWN, "failed to find linker 'cc': %s", linker.getError().message().c_str());
+
+	std::vector<llvm::StringRef> args;
+	args.push_back(*linker);
+	for (const auto &object : objects) args.push_back(object);
+	args.push_back(TPP_RUNTIME);
+	args.push_back("-o");
+	args.push_back(filename);
+	// the runtime is c++ and runs threads
+	args.push_back("-lstdc++");
+	args.push_back("-lpthread");
+	args.push_back("-lm");
+
+	std::string message;
+	if (llvm::sys::ExecuteAndWait(*linker, args, std::nullopt, {}, 0, 0, &message)) error(SourceLocation::UNKNOWN, "failed to link %s: %s", filename.c_str(), message.c_str());
+}
+
+tpp::Target::Target(OptLevel level)
+{
+	auto triple = llvm::sys::getProcessTriple();
+
+	std::string message;
+	auto target = llvm::TargetRegistry::lookupTarget(triple, message);
+	if (!target) error(SourceLocation::UNKNOWN, "failed to lookup target %s: %s", triple.c_str(), message.c_str());
+
+	llvm::StringMap<bool> host_features;
+	std::string features;
+	if (llvm::sys::getHostCPUFeatures(host_features))
+		for (const auto &feature : host_features)
+		{
+			if (!features.empty()) features += ',';
+			features += (feature.second ? '+' : '-') + feature.first().str();
+		}
+
+	llvm::TargetOptions options;
+	m_Machine.reset(target->createTargetMachine(triple, llvm::sys::getHostCPUName(), features, options, llvm::Reloc::PIC_, {}, GetCodeGenLevel(level)));
+	if (!m_Machine) error(SourceLocation::UNKNOWN, "failed to create target machine for %s", triple.c_str());
+}
+
+llvm::TargetMachine &tpp::Target::Machine() const { return *m_Machine; }
+
+void tpp::Target::Configure(llvm::Module &module) const
+{
+	module.setTargetTriple(m_Machine->getTargetTriple().str());
+	module.setDataLayout(m_Machine->createDataLayout());
+}
+
+void tpp::Target::Emit(llvm::Module &module, const std::string &filename, llvm::CodeGenFileType type) const
+{
+	std::error_code ec;
+	llvm::raw_fd_ostream stream(filename, ec, type == llvm::CGFT_AssemblyFile ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None);
+	if (ec) error(SourceLocation::UNKNOWN, "failed to open file %s: %s", filename.c_str(), ec.message().c_str());
+
+	llvm::legacy::PassManager pm;
+	if (m_Machine->addPassesToEmitFile(pm, stream, nullptr, type)) error(SourceLocation::UNKNOWN, "target cannot emit a file of this type");
+
+	pm.run(module);
+	stream.flush();
+}
@@ -50,7 +50,7 @@ void tpp::LValue::Store(const ValuePtr &value) const
 {
 	ValuePtr val = value;
 	if (val->GetType() != GetType()) val = MBuilder.CreateCast(val, GetType());
-	Store(value->Get());
+	Store(val->Get());
 }
 
 void tpp::LValue::Store(llvm::Value *value) const { MBuilder.IRBuilder().CreateStore(value, Ptr); }
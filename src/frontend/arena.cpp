@@ -0,0 +1,80 @@
+#include <TPP/Frontend/Arena.hpp>
+#include <algorithm>
+#include <cstdint>
+
+static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+tpp::Arena::Arena() = default;
+
+tpp::Arena::Arena(Arena &&other) noexcept { *this = std::move(other); }
+
+tpp::Arena &tpp::Arena::operator=(Arena &&other) noexcept
+{
+	if (this == &other) return *this;
+
+	Reset();
+	m_Blocks = std::move(other.m_Blocks);
+	m_Sizes = std::move(other.m_Sizes);
+	m_Block = other.m_Block;
+	m_Ptr = other.m_Ptr;
+	m_End = other.m_End;
+	m_Used = other.m_Used;
+	m_Destructors = std::move(other.m_Destructors);
+	m_Adopted = std::move(other.m_Adopted);
+
+	other.m_Blocks.clear();
+	other.m_Sizes.clear();
+	other.m_Destructors.clear();
+	other.m_Adopted.clear();
+	other.m_Block = 0;
+	other.m_Ptr = other.m_End = nullptr;
+	other.m_Used = 0;
+	return *this;
+}
+
+tpp::Arena::~Arena() { Reset(); }
+
+void *tpp::Arena::Allocate(size_t size, size_t align)
+{
+	auto aligned = (char *) (((uintptr_t) m_Ptr + align - 1) & ~(uintptr_t) (align - 1));
+	if (!m_Ptr || aligned + size > m_End)
+	{
+		// reuse blocks kept from before the last reset, otherwise grab a new one
+		while (m_Block < m_Blocks.size() && m_Sizes[m_Block] < size + align) ++m_Block;
+		if (m_Block == m_Blocks.size())
+		{
+			auto block_size = std::max(BLOCK_SIZE, size + align);
+			m_Blocks.emplace_back(new char[block_size]);
+			m_Sizes.push_back(block_size);
+		}
+
+		m_Ptr = m_Blocks[m_Block].get();
+		m_End = m_Ptr + m_Sizes[m_Block];
+		++m_Block;
+		aligned = (char *) (((uintptr_t) m_Ptr + align - 1) & ~(uintptr_t) (align - 1));
+	}
+
+	m_Ptr = aligned + size;
+	m_Used += size;
+	return aligned;
+}
+
+void tpp::Arena::Reset()
+{
+	for (auto it = m_Destructors.rbegin(); it != m_Destructors.rend(); ++it) it->Destroy(it->Ptr);
+	m_Destructors.clear();
+	m_Adopted.clear();
+
+	m_Block = 0;
+	m_Ptr = m_End = nullptr;
+	m_Used = 0;
+}
+
+void tpp::Arena::Adopt(Arena &&other)
+{
+	if (this == &other) return;
+	m_Used += other.m_Used;
+	m_Adopted.push_back(std::move(other));
+}
+
+size_t tpp::Arena::Used() const { return m_Used; }
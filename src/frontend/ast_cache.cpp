@@ -0,0 +1,725 @@
+#include <TPP/Frontend/Arg.hpp>
+#include <TPP/Frontend/AstCache.hpp>
+#include <TPP/Frontend/Expression.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/StructElement.hpp>
+#include <TPP/Frontend/Type.hpp>
+#include <TPP/Frontend/TypeContext.hpp>
+#include <algorithm>
+#include <cstring>
+#include <llvm/ADT/bit.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+#include <unordered_set>
+
+static constexpr char MAGIC[4] = { 'T', 'P', 'P', 'A' };
+static constexpr uint64_t VERSION = 5;
+
+static void write_u64(std::string &out, uint64_t value) { out.append((const char *) &value, sizeof(value)); }
+
+static uint64_t hash(std::string_view data) { return llvm::xxHash64(llvm::StringRef(data.data(), data.size())); }
+
+tpp::AstWriter::AstWriter(bool interface) : m_Interface(interface) {}
+
+void tpp::AstWriter::Expr(const ExprPtr &ptr)
+{
+	if (m_Interface && ptr->Kind != ExpressionKind_DefFunction && ptr->Kind != ExpressionKind_DefVariable) return;
+
+	Write(AstItemKind_Expr);
+	Write(ptr);
+}
+
+void tpp::AstWriter::Struct(Symbol name, const std::vector<StructElement> &elements)
+{
+	Write(AstItemKind_Struct);
+	Write(name);
+	Write(elements.size());
+	for (const auto &element : elements)
+	{
+		Write(element.MType);
+		Write(element.MName);
+		Write(element.Init);
+	}
+}
+
+void tpp::AstWriter::Include(const std::filesystem::path &filepath)
+{
+	Write(AstItemKind_Include);
+	Write(std::string_view(filepath.string()));
+	m_Includes.push_back(filepath.string());
+}
+
+const std::vector<std::string> &tpp::AstWriter::Includes() const { return m_Includes; }
+
+uint64_t tpp::AstWriter::Hash() const
+{
+	std::string data;
+	for (auto symbol : m_SymbolList)
+	{
+		data += symbol.String();
+		data += '\0';
+	}
+	data += m_Items;
+	return hash(data);
+}
+
+void tpp::AstWriter::Write(uint64_t value)
+{
+	do
+	{
+		char byte = value & 0x7f;
+		value >>= 7;
+		if (value) byte |= 0x80;
+		m_Items += byte;
+	} while (value);
+}
+
+void tpp::AstWriter::Write(std::string_view value)
+{
+	Write(value.size());
+	m_Items.append(value.data(), value.size());
+}
+
+void tpp::AstWriter::Write(Symbol symbol)
+{
+	if (!symbol)
+	{
+		Write(uint64_t(0));
+		return;
+	}
+
+	auto [it, inserted] = m_Symbols.emplace(symbol, m_SymbolList.size());
+	if (inserted) m_SymbolList.push_back(symbol);
+	Write(it->second + 1);
+}
+
+void tpp::AstWriter::Write(const Name &name)
+{
+	Write(name.Path.size());
+	for (auto symbol : name.Path) Write(symbol);
+}
+
+void tpp::AstWriter::Write(const TypePtr &type)
+{
+	if (!type)
+	{
+		Write(uint64_t(0));
+		return;
+	}
+
+	// structs are referenced by name and looked up again when loading, like the parser does
+	auto kind = type->Kind == TypeKind_Struct ? TypeKind_Named : type->Kind;
+	Write(kind + 1);
+
+	switch (kind)
+	{
+	case TypeKind_Named: Write(Symbol::Get(type->Name)); break;
+
+	case TypeKind_Array: Write(type->As<ArrayType>()->Base); break;
+
+	case TypeKind_Future: Write(type->As<FutureType>()->Base); break;
+
+	case TypeKind_Vector:
+	{
+		auto p = type->As<VectorType>();
+		Write(p->Base);
+		Write((uint64_t) p->Count);
+		break;
+	}
+
+	case TypeKind_FixedArray:
+	{
+		auto p = type->As<FixedArrayType>();
+		Write(p->Base);
+		Write((uint64_t) p->Count);
+		break;
+	}
+
+	case TypeKind_Function:
+	{
+		auto p = type->As<FunctionType>();
+		Write(p->Result);
+		Write(p->Args.size());
+		for (const auto &arg : p->Args) Write(arg);
+		Write(p->IsVarArg);
+		break;
+	}
+
+	default: break;
+	}
+}
+
+void tpp::AstWriter::Write(const LoopHints &hints)
+{
+	Write(hints.Vectorize);
+	Write((uint64_t) hints.VectorizeWidth);
+	Write(hints.Unroll);
+	Write((uint64_t) hints.UnrollCount);
+}
+
+void tpp::AstWriter::Write(const ExprPtr &ptr)
+{
+	if (!ptr)
+	{
+		Write(uint64_t(0));
+		return;
+	}
+
+	Write(ptr->Kind + 1);
+	Write(ptr->Location.Row);
+	Write(ptr->Location.Column);
+
+	switch (ptr->Kind)
+	{
+	case ExpressionKind_DefFunction:
+	{
+		auto e = ptr->As<DefFunctionExpression>();
+		Write(e->Result);
+		Write(e->MName);
+		Write(e->Args.size());
+		for (const auto &arg : e->Args)
+		{
+			Write(arg.Type);
+			Write(arg.Name);
+		}
+		Write(e->IsVarArg);
+		Write(m_Interface ? nullptr : e->Body);
+		break;
+	}
+	case ExpressionKind_DefVariable:
+	{
+		auto e = ptr->As<DefVariableExpression>();
+		Write(e->Type);
+		Write(e->MName);
+		Write(e->Size);
+		Write(m_Interface ? nullptr : e->Init);
+		break;
+	}
+	case ExpressionKind_Return: Write(ptr->As<ReturnExpression>()->Result); break;
+	case ExpressionKind_For:
+	{
+		auto e = ptr->As<ForExpression>();
+		Write(e->IsParallel);
+		Write(e->From);
+		Write(e->To);
+		Write(e->Step);
+		Write(e->Id);
+		Write(e->Hints);
+		Write(e->Body);
+		break;
+	}
+	case ExpressionKind_While:
+	{
+		auto e = ptr->As<WhileExpression>();
+		Write(e->Condition);
+		Write(e->Hints);
+		Write(e->Body);
+		break;
+	}
+	case ExpressionKind_If:
+	{
+		auto e = ptr->As<IfExpression>();
+		Write(e->Condition);
+		Write(e->BranchTrue);
+		Write(e->BranchFalse);
+		break;
+	}
+	case ExpressionKind_Group:
+	{
+		auto e = ptr->As<GroupExpression>();
+		Write(e->Body.size());
+		for (const auto &body : e->Body) Write(body);
+		break;
+	}
+	case ExpressionKind_Binary:
+	{
+		auto e = ptr->As<BinaryExpression>();
+		Write(e->Operator);
+		Write(e->Lhs);
+		Write(e->Rhs);
+		break;
+	}
+	case ExpressionKind_Call:
+	{
+		auto e = ptr->As<CallExpression>();
+		Write(e->IsSpawn);
+		Write(e->Callee);
+		Write(e->Args.size());
+		for (const auto &arg : e->Args) Write(arg);
+		break;
+	}
+	case ExpressionKind_Index:
+	{
+		auto e = ptr->As<IndexExpression>();
+		Write(e->Array);
+		Write(e->Index);
+		break;
+	}
+	case ExpressionKind_Member:
+	{
+		auto e = ptr->As<MemberExpression>();
+		Write(e->Object);
+		Write(e->Member);
+		break;
+	}
+	case ExpressionKind_ID: Write(ptr->As<IDExpression>()->MName); break;
+	case ExpressionKind_Number:
+	{
+		auto e = ptr->As<NumberExpression>();
+		Write(e->Type);
+		Write((uint64_t) e->IsInteger);
+		if (e->IsInteger) Write((uint64_t) e->Integer);
+		else write_u64(m_Items, llvm::bit_cast<uint64_t>(e->Value));
+		break;
+	}
+	case ExpressionKind_Char: Write((unsigned char) ptr->As<CharExpression>()->Value); break;
+	case ExpressionKind_String: Write(std::string_view(ptr->As<StringExpression>()->Value)); break;
+	case ExpressionKind_VarArgs: break;
+	case ExpressionKind_Unary:
+	{
+		auto e = ptr->As<UnaryExpression>();
+		Write(std::string_view(e->Operator));
+		Write(e->Operand);
+		break;
+	}
+	case ExpressionKind_Object:
+	{
+		auto e = ptr->As<ObjectExpression>();
+		Write(e->Init.size());
+		for (const auto &init : e->Init) Write(init);
+		break;
+	}
+	case ExpressionKind_Array:
+	{
+		auto e = ptr->As<ArrayExpression>();
+		Write(e->Size);
+		Write(m_Interface ? nullptr : e->Init);
+		break;
+	}
+	case ExpressionKind_Sync:
+	{
+		auto e = ptr->As<SyncExpression>();
+		Write(e->Future);
+		break;
+	}
+	}
+}
+
+bool tpp::AstReader::Next(AstItem &item, Arena &exprs, Arena &structs, bool deferred)
+{
+	m_Deferred = deferred;
+	item.Kind = (AstItemKind) Read();
+
+	switch (item.Kind)
+	{
+	case AstItemKind_Expr: item.Expr = ReadExpr(exprs); return true;
+
+	case AstItemKind_Struct:
+	{
+		item.Name = ReadSymbol();
+		item.Elements.clear();
+		for (auto n = Read(); n; --n)
+		{
+			auto type = ReadType();
+			auto name = ReadName();
+			auto init = ReadExpr(structs);
+			item.Elements.emplace_back(type, name, init);
+		}
+		return true;
+	}
+
+	case AstItemKind_Include: item.Include = std::string(ReadString()); return true;
+
+	default: return false;
+	}
+}
+
+uint64_t tpp::AstReader::Read()
+{
+	uint64_t value = 0;
+	for (unsigned shift = 0; m_Ptr < m_End; shift += 7)
+	{
+		auto byte = (unsigned char) *m_Ptr++;
+		value |= (uint64_t) (byte & 0x7f) << shift;
+		if (!(byte & 0x80)) break;
+	}
+	return value;
+}
+
+std::string_view tpp::AstReader::ReadString()
+{
+	auto size = std::min<uint64_t>(Read(), m_End - m_Ptr);
+	std::string_view value(m_Ptr, size);
+	m_Ptr += size;
+	return value;
+}
+
+tpp::Symbol tpp::AstReader::ReadSymbol()
+{
+	auto index = Read();
+	return index && index <= m_Symbols.size() ? m_Symbols[index - 1] : Symbol();
+}
+
+tpp::Name tpp::AstReader::ReadName()
+{
+	Name name;
+	for (auto n = Read(); n; --n) name.Append(ReadSymbol());
+	return name;
+}
+
+tpp::TypePtr tpp::AstReader::ReadType()
+{
+	auto tag = Read();
+	if (!tag) return nullptr;
+
+	auto kind = (TypeKind) (tag - 1);
+	switch (kind)
+	{
+	case TypeKind_Named:
+	{
+		auto name = ReadSymbol();
+		return m_Deferred ? Type::GetDeferred(name) : Type::Get(name, true);
+	}
+
+	case TypeKind_Array: return Type::GetArray(ReadType());
+
+	case TypeKind_Future: return Type::GetFuture(ReadType());
+
+	case TypeKind_Vector:
+	{
+		auto base = ReadType();
+		auto count = (unsigned) Read();
+		return Type::GetVector(base, count);
+	}
+
+	case TypeKind_FixedArray:
+	{
+		auto base = ReadType();
+		auto count = (unsigned) Read();
+		return Type::GetFixedArray(base, count);
+	}
+
+	case TypeKind_Function:
+	{
+		auto result = ReadType();
+		std::vector<TypePtr> args(Read());
+		for (auto &arg : args) arg = ReadType();
+		bool is_var_arg = Read();
+		return Type::GetFunction(result, args, is_var_arg);
+	}
+
+	default: return TypeContext::Global().GetPrimitive(kind);
+	}
+}
+
+tpp::LoopHints tpp::AstReader::ReadHints()
+{
+	LoopHints hints;
+	hints.Vectorize = Read();
+	hints.VectorizeWidth = (unsigned) Read();
+	hints.Unroll = Read();
+	hints.UnrollCount = (unsigned) Read();
+	return hints;
+}
+
+tpp::ExprPtr tpp::AstReader::ReadExpr(Arena &arena)
+{
+	auto tag = Read();
+	if (!tag) return nullptr;
+
+	SourceLocation location{ m_Filepath };
+	location.Row = Read();
+	location.Column = Read();
+
+	switch ((ExpressionKind) (tag - 1))
+	{
+	case ExpressionKind_DefFunction:
+	{
+		auto result = ReadType();
+		auto name = ReadName();
+		std::vector<Arg> args;
+		for (auto n = Read(); n; --n)
+		{
+			auto type = ReadType();
+			args.emplace_back(type, ReadSymbol());
+		}
+		bool is_var_arg = Read();
+		auto body = ReadExpr(arena);
+		return arena.New<DefFunctionExpression>(location, result, name, args, is_var_arg, body);
+	}
+	case ExpressionKind_DefVariable:
+	{
+		auto type = ReadType();
+		auto name = ReadName();
+		auto size = ReadExpr(arena);
+		auto init = ReadExpr(arena);
+		return arena.New<DefVariableExpression>(location, type, name, size, init);
+	}
+	case ExpressionKind_Return: return arena.New<ReturnExpression>(location, ReadExpr(arena));
+	case ExpressionKind_For:
+	{
+		bool is_parallel = Read();
+		auto from = ReadExpr(arena);
+		auto to = ReadExpr(arena);
+		auto step = ReadExpr(arena);
+		auto id = ReadSymbol();
+		auto hints = ReadHints();
+		auto body = ReadExpr(arena);
+		return arena.New<ForExpression>(location, is_parallel, from, to, step, id, hints, body);
+	}
+	case ExpressionKind_While:
+	{
+		auto condition = ReadExpr(arena);
+		auto hints = ReadHints();
+		auto body = ReadExpr(arena);
+		return arena.New<WhileExpression>(location, condition, hints, body);
+	}
+	case ExpressionKind_If:
+	{
+		auto condition = ReadExpr(arena);
+		auto branch_true = ReadExpr(arena);
+		auto branch_false = ReadExpr(arena);
+		return arena.New<IfExpression>(location, condition, branch_true, branch_false);
+	}
+	case ExpressionKind_Group:
+	{
+		std::vector<ExprPtr> body(Read());
+		for (auto &e : body) e = ReadExpr(arena);
+		return arena.New<GroupExpression>(location, body);
+	}
+	case ExpressionKind_Binary:
+	{
+		auto op = (BinaryOp) Read();
+		auto lhs = ReadExpr(arena);
+		auto rhs = ReadExpr(arena);
+		return arena.New<BinaryExpression>(location, op, lhs, rhs);
+	}
+	case ExpressionKind_Call:
+	{
+		bool is_spawn = Read();
+		auto callee = ReadName();
+		std::vector<ExprPtr> args(Read());
+		for (auto &e : args) e = ReadExpr(arena);
+		auto call = arena.New<CallExpression>(location, callee, args);
+		call->IsSpawn = is_spawn;
+		return call;
+	}
+	case ExpressionKind_Index:
+	{
+		auto array = ReadExpr(arena);
+		auto index = ReadExpr(arena);
+		return arena.New<IndexExpression>(location, array, index);
+	}
+	case ExpressionKind_Member:
+	{
+		auto object = ReadExpr(arena);
+		return arena.New<MemberExpression>(location, object, ReadSymbol());
+	}
+	case ExpressionKind_ID: return arena.New<IDExpression>(location, ReadName());
+	case ExpressionKind_Number:
+	{
+		auto type = ReadType();
+		bool is_integer = Read();
+		if (is_integer)
+		{
+			auto integer = (int64_t) Read();
+			return arena.New<NumberExpression>(location, type, true, integer, (double) integer);
+		}
+
+		uint64_t bits = 0;
+		if (m_End - m_Ptr >= (ptrdiff_t) sizeof(bits)) memcpy(&bits, m_Ptr, sizeof(bits));
+		m_Ptr = std::min(m_Ptr + sizeof(bits), m_End);
+		return arena.New<NumberExpression>(location, type, false, 0, llvm::bit_cast<double>(bits));
+	}
+	case ExpressionKind_Char: return arena.New<CharExpression>(location, (char) Read());
+	case ExpressionKind_String: return arena.New<StringExpression>(location, std::string(ReadString()));
+	case ExpressionKind_VarArgs: return arena.New<VarArgsExpression>(location);
+	case ExpressionKind_Unary:
+	{
+		auto op = std::string(ReadString());
+		return arena.New<UnaryExpression>(location, op, ReadExpr(arena));
+	}
+	case ExpressionKind_Object:
+	{
+		std::vector<ExprPtr> init(Read());
+		for (auto &e : init) e = ReadExpr(arena);
+		return arena.New<ObjectExpression>(location, init);
+	}
+	case ExpressionKind_Array:
+	{
+		auto size = ReadExpr(arena);
+		auto init = ReadExpr(arena);
+		return arena.New<ArrayExpression>(location, size, init);
+	}
+	case ExpressionKind_Sync: return arena.New<SyncExpression>(location, ReadExpr(arena));
+	}
+
+	error(location, "corrupt ast cache entry");
+}
+
+tpp::AstCache::AstCache(const std::filesystem::path &directory) : m_Directory(directory) { llvm::sys::fs::create_directories(directory.string()); }
+
+std::unique_ptr<tpp::AstReader> tpp::AstCache::Open(const std::filesystem::path &filepath)
+{
+	auto path = filepath.string();
+	auto buffer = llvm::MemoryBuffer::getFile(EntryPath(path).string(), false, false);
+	if (!buffer) return nullptr;
+
+	auto reader = std::make_unique<AstReader>();
+	reader->m_Buffer = std::move(*buffer);
+	reader->m_Filepath = SourceLocation::Intern(filepath);
+	reader->m_Ptr = reader->m_Buffer->getBufferStart();
+	reader->m_End = reader->m_Buffer->getBufferEnd();
+
+	Header header;
+	if (!ReadHeader(*reader, header)) return nullptr;
+	if (header.Checksum != hash(std::string_view(reader->m_Ptr, reader->m_End - reader->m_Ptr))) return nullptr;
+	if (header.Content != ContentHash(path)) return nullptr;
+
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Includes[path] = header.Includes;
+	}
+	if (header.Key != Key(path)) return nullptr;
+
+	reader->m_Symbols.resize(reader->Read());
+	for (auto &symbol : reader->m_Symbols) symbol = Symbol::Get(reader->ReadString());
+	return reader;
+}
+
+void tpp::AstCache::Store(const std::filesystem::path &filepath, AstWriter &&writer)
+{
+	auto path = filepath.string();
+
+	std::lock_guard lock(m_Mutex);
+	m_Includes[path] = writer.m_Includes;
+	m_Pending.emplace_back(path, std::move(writer));
+}
+
+void tpp::AstCache::Flush()
+{
+	std::vector<std::pair<std::string, AstWriter>> pending;
+	{
+		std::lock_guard lock(m_Mutex);
+		pending.swap(m_Pending);
+	}
+
+	for (const auto &[path, writer] : pending) Write(path, writer);
+}
+
+std::filesystem::path tpp::AstCache::EntryPath(const std::string &filepath) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.ast", (unsigned long long) hash(filepath));
+	return m_Directory / name;
+}
+
+bool tpp::AstCache::ReadHeader(AstReader &reader, Header &header)
+{
+	if (reader.m_End - reader.m_Ptr < (ptrdiff_t) (sizeof(MAGIC) + 1 + 3 * sizeof(uint64_t))) return false;
+	if (memcmp(reader.m_Ptr, MAGIC, sizeof(MAGIC))) return false;
+	reader.m_Ptr += sizeof(MAGIC);
+	if (reader.Read() != VERSION) return false;
+
+	for (auto value : { &header.Content, &header.Key, &header.Checksum })
+	{
+		if (reader.m_End - reader.m_Ptr < (ptrdiff_t) sizeof(uint64_t)) return false;
+		memcpy(value, reader.m_Ptr, sizeof(uint64_t));
+		reader.m_Ptr += sizeof(uint64_t);
+	}
+
+	header.Includes.resize(reader.Read());
+	for (auto &include : header.Includes) include = std::string(reader.ReadString());
+	return reader.m_Ptr <= reader.m_End;
+}
+
+uint64_t tpp::AstCache::ContentHash(const std::string &filepath)
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		if (auto it = m_Hashes.find(filepath); it != m_Hashes.end()) return it->second;
+	}
+
+	auto buffer = llvm::MemoryBuffer::getFile(filepath, false, false);
+	auto value = buffer ? hash(std::string_view((*buffer)->getBufferStart(), (*buffer)->getBufferSize())) : 0;
+
+	std::lock_guard lock(m_Mutex);
+	return m_Hashes[filepath] = value;
+}
+
+bool tpp::AstCache::GetIncludes(const std::string &filepath, std::vector<std::string> &includes)
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		if (auto it = m_Includes.find(filepath); it != m_Includes.end())
+		{
+			includes = it->second;
+			return true;
+		}
+	}
+
+	// a file that was neither parsed nor loaded yet contributes the include list of its entry
+	auto buffer = llvm::MemoryBuffer::getFile(EntryPath(filepath).string(), false, false);
+	if (!buffer) return false;
+
+	AstReader reader;
+	reader.m_Ptr = (*buffer)->getBufferStart();
+	reader.m_End = (*buffer)->getBufferEnd();
+
+	Header header;
+	if (!ReadHeader(reader, header)) return false;
+	includes = std::move(header.Includes);
+	return true;
+}
+
+uint64_t tpp::AstCache::Key(const std::string &filepath)
+{
+	// content of every file reachable through includes, in depth-first order, each file once; include cycles included
+	std::string data;
+	std::unordered_set<std::string> visited;
+	std::vector<std::string> stack{ filepath };
+	std::vector<std::string> includes;
+
+	while (!stack.empty())
+	{
+		auto path = std::move(stack.back());
+		stack.pop_back();
+		if (!visited.insert(path).second) continue;
+
+		if (!GetIncludes(path, includes)) return 0;
+		write_u64(data, ContentHash(path));
+		stack.insert(stack.end(), includes.rbegin(), includes.rend());
+	}
+
+	return hash(data);
+}
+
+void tpp::AstCache::Write(const std::string &filepath, const AstWriter &writer)
+{
+	AstWriter body;
+	body.Write(writer.m_SymbolList.size());
+	for (auto symbol : writer.m_SymbolList) body.Write(symbol.String());
+	body.m_Items += writer.m_Items;
+	body.Write(AstItemKind_End);
+
+	AstWriter head;
+	head.m_Items.append(MAGIC, sizeof(MAGIC));
+	head.Write(VERSION);
+	write_u64(head.m_Items, ContentHash(filepath));
+	write_u64(head.m_Items, Key(filepath));
+	write_u64(head.m_Items, hash(body.m_Items));
+	head.Write(writer.m_Includes.size());
+	for (const auto &include : writer.m_Includes) head.Write(std::string_view(include));
+
+	// written next to the entry and renamed, so a concurrent compile never maps a partial file
+	auto entry = EntryPath(filepath);
+	int fd;
+	llvm::SmallString<128> temp;
+	if (llvm::sys::fs::createUniqueFile(entry.string() + ".%%%%%%.tmp", fd, temp)) return;
+	{
+		llvm::raw_fd_ostream stream(fd, true);
+		stream << head.m_Items << body.m_Items;
+	}
+	if (llvm::sys::fs::rename(temp, entry.string())) llvm::sys::fs::remove(temp);
+}
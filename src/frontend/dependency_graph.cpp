@@ -0,0 +1,65 @@
+#include <TPP/Frontend/AstCache.hpp>
+#include <TPP/Frontend/DependencyGraph.hpp>
+#include <unordered_set>
+
+tpp::AstWriter &tpp::DependencyGraph::Add(const std::filesystem::path &filepath)
+{
+	std::lock_guard lock(m_Mutex);
+	auto &ref = m_Files[filepath.string()];
+	ref = std::make_unique<AstWriter>(true);
+	return *ref;
+}
+
+void tpp::DependencyGraph::Deliver(const std::filesystem::path &filepath)
+{
+	std::lock_guard lock(m_Mutex);
+	m_Order.push_back(filepath.string());
+}
+
+std::vector<std::string> tpp::DependencyGraph::Closure(const std::string &filepath) const
+{
+	std::lock_guard lock(m_Mutex);
+
+	// depth-first in include order, each file once
+	std::vector<std::string> closure;
+	std::unordered_set<std::string> visited;
+	std::vector<std::string> stack{ filepath };
+
+	while (!stack.empty())
+	{
+		auto path = std::move(stack.back());
+		stack.pop_back();
+		if (!visited.insert(path).second) continue;
+
+		closure.push_back(path);
+		if (auto it = m_Files.find(path); it != m_Files.end()) stack.insert(stack.end(), it->second->Includes().rbegin(), it->second->Includes().rend());
+	}
+
+	return closure;
+}
+
+std::vector<std::string> tpp::DependencyGraph::Visible(const std::string &filepath) const
+{
+	std::vector<std::string> visible;
+	{
+		std::lock_guard lock(m_Mutex);
+		for (const auto &path : m_Order)
+		{
+			if (path == filepath) break;
+			visible.push_back(path);
+		}
+	}
+
+	// includes delivered later in the file still declare what follows them
+	std::unordered_set<std::string> seen(visible.begin(), visible.end());
+	for (auto &path : Closure(filepath))
+		if (seen.insert(path).second) visible.push_back(std::move(path));
+	return visible;
+}
+
+uint64_t tpp::DependencyGraph::Interface(const std::string &filepath) const
+{
+	std::lock_guard lock(m_Mutex);
+	auto it = m_Files.find(filepath);
+	return it != m_Files.end() ? it->second->Hash() : 0;
+}
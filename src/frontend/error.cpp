@@ -5,7 +5,7 @@
 
 void tpp::error(const SourceLocation &location, const char *format, ...)
 {
-	printf("At %s(%zu,%zu): ", location.Filepath.string().c_str(), location.Row, location.Column);
+	printf("At %s(%zu,%zu): ", location.Filepath->string().c_str(), location.Row, location.Column);
 
 	va_list ap;
 	va_start(ap, format);
@@ -2,18 +2,24 @@
 #include <TPP/Frontend/Frontend.hpp>
 #include <TPP/Frontend/SourceLocation.hpp>
 #include <TPP/Frontend/Type.hpp>
+#include <TPP/Frontend/TypeContext.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
 #include <functional>
 #include <memory>
-#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-tpp::Expression::Expression(const SourceLocation &location) : Location(location) {}
+tpp::Expression::Expression(ExpressionKind kind, const SourceLocation &location) : Kind(kind), Location(location) {}
 
 tpp::Expression::~Expression() = default;
 
 tpp::DefFunctionExpression::DefFunctionExpression(const SourceLocation &location, const TypePtr &result, const Name &name, const std::vector<Arg> &args, bool is_var_arg, const ExprPtr &body)
-	: Expression(location), Result(result), MName(name), Args(args), IsVarArg(is_var_arg), Body(body)
+	: Expression(KIND, location), Result(result), MName(name), Args(args), IsVarArg(is_var_arg), Body(body)
 {
 }
 
@@ -25,83 +31,162 @@ tpp::TypePtr tpp::DefFunctionExpression::GetType() const
 }
 
 tpp::DefVariableExpression::DefVariableExpression(const SourceLocation &location, const TypePtr &type, const Name &name, const ExprPtr &size, const ExprPtr &init)
-	: Expression(location), Type(type), MName(name), Size(size), Init(init)
+	: Expression(KIND, location), Type(type), MName(name), Size(size), Init(init)
 {
 }
 
 tpp::TypePtr tpp::DefVariableExpression::GetType() const { return Type; }
 
-tpp::ReturnExpression::ReturnExpression(const SourceLocation &location, const ExprPtr &result) : Expression(location), Result(result) {}
+tpp::ReturnExpression::ReturnExpression(const SourceLocation &location, const ExprPtr &result) : Expression(KIND, location), Result(result) {}
 
 tpp::TypePtr tpp::ReturnExpression::GetType() const { return Result->GetType(); }
 
-tpp::ForExpression::ForExpression(const SourceLocation &location, const ExprPtr &from, const ExprPtr &to, const ExprPtr &step, const std::string &id, const ExprPtr &body)
-	: Expression(location), From(from), To(to), Step(step), Id(id), Body(body)
+tpp::ForExpression::ForExpression(const SourceLocation &location, bool is_parallel, const ExprPtr &from, const ExprPtr &to, const ExprPtr &step, Symbol id, const LoopHints &hints, const ExprPtr &body)
+	: Expression(KIND, location), IsParallel(is_parallel), From(from), To(to), Step(step), Id(id), Hints(hints), Body(body)
 {
 }
 
 tpp::TypePtr tpp::ForExpression::GetType() const { return Body->GetType(); }
 
-tpp::WhileExpression::WhileExpression(const SourceLocation &location, const ExprPtr &condition, const ExprPtr &body) : Expression(location), Condition(condition), Body(body) {}
+tpp::WhileExpression::WhileExpression(const SourceLocation &location, const ExprPtr &condition, const LoopHints &hints, const ExprPtr &body)
+	: Expression(KIND, location), Condition(condition), Hints(hints), Body(body)
+{
+}
 
 tpp::TypePtr tpp::WhileExpression::GetType() const { return Body->GetType(); }
 
 tpp::IfExpression::IfExpression(const SourceLocation &location, const ExprPtr &condition, const ExprPtr &branchTrue, const ExprPtr &branchFalse)
-	: Expression(location), Condition(condition), BranchTrue(branchTrue), BranchFalse(branchFalse)
+	: Expression(KIND, location), Condition(condition), BranchTrue(branchTrue), BranchFalse(branchFalse)
 {
 }
 
 tpp::TypePtr tpp::IfExpression::GetType() const { return BranchTrue->GetType(); }
 
-tpp::GroupExpression::GroupExpression(const SourceLocation &location, const std::vector<ExprPtr> &body) : Expression(location), Body(body) {}
+tpp::GroupExpression::GroupExpression(const SourceLocation &location, const std::vector<ExprPtr> &body) : Expression(KIND, location), Body(body) {}
 
 tpp::TypePtr tpp::GroupExpression::GetType() const { return Body.back()->GetType(); }
 
-tpp::BinaryExpression::BinaryExpression(const SourceLocation &location, const std::string &op, const ExprPtr &lhs, const ExprPtr &rhs) : Expression(location), Operator(op), Lhs(lhs), Rhs(rhs) {}
+tpp::BinaryExpression::BinaryExpression(const SourceLocation &location, BinaryOp op, const ExprPtr &lhs, const ExprPtr &rhs) : Expression(KIND, location), Operator(op), Lhs(lhs), Rhs(rhs) {}
 
 tpp::TypePtr tpp::BinaryExpression::GetType() const { error(Location, "TODO"); }
 
-tpp::CallExpression::CallExpression(const SourceLocation &location, const Name &callee, const std::vector<ExprPtr> &args) : Expression(location), Callee(callee), Args(args) {}
+tpp::CallExpression::CallExpression(const SourceLocation &location, const Name &callee, const std::vector<ExprPtr> &args) : Expression(KIND, location), Callee(callee), Args(args) {}
 
 tpp::TypePtr tpp::CallExpression::GetType() const { error(Location, "TODO"); }
 
-tpp::IndexExpression::IndexExpression(const SourceLocation &location, const ExprPtr &array, const ExprPtr &index) : Expression(location), Array(array), Index(index) {}
+tpp::IndexExpression::IndexExpression(const SourceLocation &location, const ExprPtr &array, const ExprPtr &index) : Expression(KIND, location), Array(array), Index(index) {}
 
-tpp::TypePtr tpp::IndexExpression::GetType() const { return std::dynamic_pointer_cast<ArrayType>(Array->GetType())->Base; }
+tpp::TypePtr tpp::IndexExpression::GetType() const { return Array->GetType()->As<ArrayType>()->Base; }
 
-tpp::MemberExpression::MemberExpression(const SourceLocation &location, const ExprPtr &object, const std::string &member) : Expression(location), Object(object), Member(member) {}
+tpp::MemberExpression::MemberExpression(const SourceLocation &location, const ExprPtr &object, Symbol member) : Expression(KIND, location), Object(object), Member(member) {}
 
 tpp::TypePtr tpp::MemberExpression::GetType() const { error(Location, "TODO"); }
 
-tpp::IDExpression::IDExpression(const SourceLocation &location, const Name &name) : Expression(location), MName(name) {}
+tpp::IDExpression::IDExpression(const SourceLocation &location, const Name &name) : Expression(KIND, location), MName(name) {}
 
 tpp::TypePtr tpp::IDExpression::GetType() const { error(Location, "TODO"); }
 
-tpp::NumberExpression::NumberExpression(const SourceLocation &location, const std::string &value) : Expression(location), Value(std::stod(value)) {}
+static constexpr std::pair<std::string_view, tpp::TypeKind> SUFFIXES[] = {
+	{ "i1", tpp::TypeKind_I1 },	  { "i8", tpp::TypeKind_I8 },	{ "i16", tpp::TypeKind_I16 }, { "i32", tpp::TypeKind_I32 }, { "i64", tpp::TypeKind_I64 },
+	{ "i128", tpp::TypeKind_I128 }, { "f16", tpp::TypeKind_F16 }, { "f32", tpp::TypeKind_F32 }, { "f64", tpp::TypeKind_F64 },
+};
 
-tpp::TypePtr tpp::NumberExpression::GetType() const { return Type::GetF64(); }
+static bool is_integer_type(const tpp::TypePtr &type) { return type->Kind >= tpp::TypeKind_I1 && type->Kind <= tpp::TypeKind_I128; }
 
-tpp::CharExpression::CharExpression(const SourceLocation &location, const std::string &value) : Expression(location), Value(value[0]) {}
+static bool is_float_type(const tpp::TypePtr &type) { return type->Kind >= tpp::TypeKind_F16 && type->Kind <= tpp::TypeKind_F64; }
+
+static bool fits(int64_t value, tpp::TypeKind kind)
+{
+	switch (kind)
+	{
+	case tpp::TypeKind_I1: return value == 0 || value == 1;
+	case tpp::TypeKind_I8: return value >= INT8_MIN && value <= INT8_MAX;
+	case tpp::TypeKind_I16: return value >= INT16_MIN && value <= INT16_MAX;
+	case tpp::TypeKind_I32: return value >= INT32_MIN && value <= INT32_MAX;
+	default: return true;
+	}
+}
+
+tpp::NumberExpression::NumberExpression(const SourceLocation &location, const std::string &value) : Expression(KIND, location)
+{
+	// hex and binary literals are integers, decimal ones unless they have a fraction or exponent; a suffix like i32 or f32 fixes the type
+	std::string_view text = value;
+	int base = 10;
+	if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) base = 16;
+	else if (text.size() > 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) base = 2;
+	if (base != 10) text.remove_prefix(2);
+
+	auto suffix = text.find_first_of(base == 10 ? "if" : "i");
+	if (suffix != std::string_view::npos)
+	{
+		auto it = std::find_if(std::begin(SUFFIXES), std::end(SUFFIXES), [&](const auto &entry) { return entry.first == text.substr(suffix); });
+		if (it == std::end(SUFFIXES)) error(location, "invalid number suffix: %s", value.c_str());
+		Type = TypeContext::Global().GetPrimitive(it->second);
+		text = text.substr(0, suffix);
+	}
+
+	std::string digits(text);
+	bool is_float_literal = base == 10 && digits.find_first_of(".eE") != std::string::npos;
+	if (is_float_literal && Type && !is_float_type(Type)) error(location, "invalid integer literal: %s", value.c_str());
+	IsInteger = !is_float_literal && !(Type && is_float_type(Type));
+
+	char *end = nullptr;
+	errno = 0;
+	if (is_float_literal) Value = std::strtod(digits.c_str(), &end);
+	else
+	{
+		auto bits = std::strtoull(digits.c_str(), &end, base);
+		Integer = (int64_t) bits;
+		Value = (double) bits;
+		// hex and binary spell out all 64 bits of the two's complement, so 0xffffffffffffffff is -1; a decimal has to fit in i64 as it is
+		if (base == 10 && bits > (uint64_t) INT64_MAX) errno = ERANGE;
+	}
+	if (digits.empty() || *end || errno == ERANGE) error(location, "invalid number: %s", value.c_str());
+}
+
+tpp::NumberExpression::NumberExpression(const SourceLocation &location, const TypePtr &type, bool is_integer, int64_t integer, double value)
+	: Expression(KIND, location), Type(type), IsInteger(is_integer), Integer(integer), Value(value)
+{
+}
+
+tpp::TypePtr tpp::NumberExpression::GetType() const
+{
+	if (Type) return Type;
+	if (!IsInteger) return tpp::Type::GetF64();
+	return fits(Integer, TypeKind_I32) ? tpp::Type::GetI32() : tpp::Type::GetI64();
+}
+
+tpp::TypePtr tpp::NumberExpression::GetType(const TypePtr &context) const
+{
+	if (Type || !context) return GetType();
+	if (IsInteger && is_integer_type(context) && fits(Integer, context->Kind)) return context;
+	if (is_float_type(context)) return context;
+	return GetType();
+}
+
+tpp::CharExpression::CharExpression(const SourceLocation &location, const std::string &value) : Expression(KIND, location), Value(value[0]) {}
+
+tpp::CharExpression::CharExpression(const SourceLocation &location, char value) : Expression(KIND, location), Value(value) {}
 
 tpp::TypePtr tpp::CharExpression::GetType() const { return Type::GetI8(); }
 
-tpp::StringExpression::StringExpression(const SourceLocation &location, const std::string &value) : Expression(location), Value(value) {}
+tpp::StringExpression::StringExpression(const SourceLocation &location, const std::string &value) : Expression(KIND, location), Value(value) {}
 
 tpp::TypePtr tpp::StringExpression::GetType() const { return Type::GetArray(Type::GetI8()); }
 
-tpp::VarArgsExpression::VarArgsExpression(const SourceLocation &location) : Expression(location) {}
+tpp::VarArgsExpression::VarArgsExpression(const SourceLocation &location) : Expression(KIND, location) {}
 
 tpp::TypePtr tpp::VarArgsExpression::GetType() const { error(Location, "TODO"); }
 
-tpp::UnaryExpression::UnaryExpression(const SourceLocation &location, const std::string &op, const ExprPtr &operand) : Expression(location), Operator(op), Operand(operand) {}
+tpp::UnaryExpression::UnaryExpression(const SourceLocation &location, const std::string &op, const ExprPtr &operand) : Expression(KIND, location), Operator(op), Operand(operand) {}
 
 tpp::TypePtr tpp::UnaryExpression::GetType() const { error(Location, "TODO"); }
 
-tpp::ObjectExpression::ObjectExpression(const SourceLocation &location, const std::vector<ExprPtr> &init) : Expression(location), Init(init) {}
+tpp::ObjectExpression::ObjectExpression(const SourceLocation &location, const std::vector<ExprPtr> &init) : Expression(KIND, location), Init(init) {}
 
 tpp::TypePtr tpp::ObjectExpression::GetType() const { error(Location, "TODO"); }
 
-tpp::ArrayExpression::ArrayExpression(const SourceLocation &location, const ExprPtr &size, const ExprPtr &init) : Expression(location), Size(size), Init(init) {}
+tpp::ArrayExpression::ArrayExpression(const SourceLocation &location, const ExprPtr &size, const ExprPtr &init) : Expression(KIND, location), Size(size), Init(init) {}
 
 tpp::TypePtr tpp::ArrayExpression::GetType() const
 {
@@ -109,30 +194,15 @@ tpp::TypePtr tpp::ArrayExpression::GetType() const
 	error(Location, "TODO");
 }
 
+tpp::SyncExpression::SyncExpression(const SourceLocation &location, const ExprPtr &future) : Expression(KIND, location), Future(future) {}
+
+tpp::TypePtr tpp::SyncExpression::GetType() const { return Future->GetType()->As<FutureType>()->Base; }
+
 std::ostream &tpp::operator<<(std::ostream &out, const ExprPtr &ptr)
 {
 	if (!ptr) return out << "<null>";
 
-	if (auto p = std::dynamic_pointer_cast<DefFunctionExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<DefVariableExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<ReturnExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<ForExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<WhileExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<IfExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<GroupExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<BinaryExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<CallExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<IndexExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<MemberExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<IDExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<NumberExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<CharExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<StringExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<VarArgsExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<UnaryExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<ObjectExpression>(ptr)) return out << *p;
-	if (auto p = std::dynamic_pointer_cast<ArrayExpression>(ptr)) return out << *p;
-	throw std::runtime_error("TODO");
+	return Visit(*ptr, [&out](const auto &e) -> std::ostream & { return out << e; });
 }
 
 static unsigned depth = 0;
@@ -186,14 +256,14 @@ std::ostream &tpp::operator<<(std::ostream &out, const ReturnExpression &e) { re
 
 std::ostream &tpp::operator<<(std::ostream &out, const ForExpression &e)
 {
-	out << "for [" << e.From << ", " << e.To;
+	out << (e.IsParallel ? "pfor [" : "for [") << e.From << ", " << e.To;
 	if (e.Step) out << ", " << e.Step;
 	out << "] ";
-	if (!e.Id.empty()) out << "-> " << e.Id << ' ';
-	return out << e.Body;
+	if (e.Id) out << "-> " << e.Id << ' ';
+	return out << e.Hints << e.Body;
 }
 
-std::ostream &tpp::operator<<(std::ostream &out, const WhileExpression &e) { return out << "while [" << e.Condition << "] " << e.Body; }
+std::ostream &tpp::operator<<(std::ostream &out, const WhileExpression &e) { return out << "while [" << e.Condition << "] " << e.Hints << e.Body; }
 
 std::ostream &tpp::operator<<(std::ostream &out, const IfExpression &e)
 {
@@ -215,10 +285,11 @@ std::ostream &tpp::operator<<(std::ostream &out, const GroupExpression &e)
 	return out << std::endl << spaces << ')';
 }
 
-std::ostream &tpp::operator<<(std::ostream &out, const BinaryExpression &e) { return out << e.Lhs << ' ' << e.Operator << ' ' << e.Rhs; }
+std::ostream &tpp::operator<<(std::ostream &out, const BinaryExpression &e) { return out << e.Lhs << ' ' << GetInfo(e.Operator).Text << ' ' << e.Rhs; }
 
 std::ostream &tpp::operator<<(std::ostream &out, const CallExpression &e)
 {
+	if (e.IsSpawn) out << "spawn ";
 	out << e.Callee << '(';
 	for (size_t i = 0; i < e.Args.size(); ++i)
 	{
@@ -234,7 +305,13 @@ std::ostream &tpp::operator<<(std::ostream &out, const MemberExpression &e) { re
 
 std::ostream &tpp::operator<<(std::ostream &out, const IDExpression &e) { return out << e.MName; }
 
-std::ostream &tpp::operator<<(std::ostream &out, const NumberExpression &e) { return out << e.Value; }
+std::ostream &tpp::operator<<(std::ostream &out, const NumberExpression &e)
+{
+	if (e.IsInteger) out << e.Integer;
+	else out << e.Value;
+	if (e.Type) out << e.Type->Name;
+	return out;
+}
 
 std::ostream &tpp::operator<<(std::ostream &out, const CharExpression &e) { return out << '\'' << (char) (e.Value < 0x20 ? 0 : e.Value) << '\''; }
 
@@ -264,3 +341,5 @@ std::ostream &tpp::operator<<(std::ostream &out, const ArrayExpression &e)
 	if (e.Init) out << ", " << e.Init;
 	return out << ']';
 }
+
+std::ostream &tpp::operator<<(std::ostream &out, const SyncExpression &e) { return out << "sync " << e.Future; }
@@ -0,0 +1,379 @@
+#include <TPP/Frontend/Expression.hpp>
+#include <TPP/Frontend/Folder.hpp>
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <TPP/Frontend/Type.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// the folder mirrors how the builder lowers constants: integers are signed and wrap, casts sign-extend, and an operation happens in the higher order type of its operands;
+// an unsuffixed literal takes the type of the other operand, and arithmetic on two of them stays unsuffixed and is exact in 64 bits or double precision
+
+static unsigned int_width(const tpp::TypePtr &type)
+{
+	switch (type->Kind)
+	{
+	case tpp::TypeKind_I1: return 1;
+	case tpp::TypeKind_I8: return 8;
+	case tpp::TypeKind_I16: return 16;
+	case tpp::TypeKind_I32: return 32;
+	case tpp::TypeKind_I64: return 64;
+	default: return 0;
+	}
+}
+
+// f16 and i128 constants are left to llvm
+static bool is_float(const tpp::TypePtr &type) { return type->Kind == tpp::TypeKind_F32 || type->Kind == tpp::TypeKind_F64; }
+
+static int64_t wrap(uint64_t value, unsigned width) { return width == 64 ? (int64_t) value : (int64_t) (value << (64 - width)) >> (64 - width); }
+
+static double round_to(const tpp::TypePtr &type, double value) { return type->Kind == tpp::TypeKind_F32 ? (double) (float) value : value; }
+
+static bool to_bool(const tpp::NumberExpression *value) { return value->IsInteger ? value->Integer != 0 : value->Value != 0; }
+
+static tpp::NumberExpression *untyped(tpp::NumberExpression *value)
+{
+	if (value) value->Type = nullptr;
+	return value;
+}
+
+static tpp::TypePtr get_higher_order(const tpp::TypePtr &a, const tpp::TypePtr &b)
+{
+	if (a == b) return a;
+
+	auto width_a = int_width(a), width_b = int_width(b);
+	if (width_a && width_b) return width_a > width_b ? a : b;
+	if (is_float(a) && is_float(b)) return a->Kind > b->Kind ? a : b;
+	if (is_float(a) && width_b) return a;
+	if (width_a && is_float(b)) return b;
+	return nullptr;
+}
+
+tpp::ExprPtr tpp::Folder::Fold(const ExprPtr &ptr)
+{
+	m_TopLevel = ptr;
+	auto result = FoldExpr(ptr);
+	m_Locals.clear();
+	return result;
+}
+
+tpp::ExprPtr tpp::Folder::FoldExpr(const ExprPtr &ptr)
+{
+	if (!ptr) return ptr;
+
+	switch (ptr->Kind)
+	{
+	case ExpressionKind_DefFunction:
+	{
+		auto e = ptr->As<DefFunctionExpression>();
+		// functions run at any time, globals are only known to be constant while the global initializers run
+		m_InFunction = true;
+		e->Body = FoldExpr(e->Body);
+		m_InFunction = false;
+		return ptr;
+	}
+
+	case ExpressionKind_DefVariable:
+	{
+		auto e = ptr->As<DefVariableExpression>();
+		e->Size = FoldExpr(e->Size);
+		e->Init = FoldExpr(e->Init);
+
+		auto init = GetConstant(e->Init);
+		if (init) init = Cast(init, e->Type ? e->Type : init->GetType());
+		if (init) e->Init = init;
+
+		if (ptr != m_TopLevel)
+		{
+			m_Locals.push_back(e->MName);
+			return ptr;
+		}
+
+		// a global without initializer starts out as zero; the initializer itself may die with the parser's arena
+		if (init) m_Globals[e->MName] = New(init->Location, init->Type, init->Integer, init->Value);
+		else if (!e->Init && e->Type && (int_width(e->Type) || is_float(e->Type))) m_Globals[e->MName] = New(e->Location, e->Type, 0, 0);
+		else m_Globals.erase(e->MName);
+		return ptr;
+	}
+
+	case ExpressionKind_Return:
+	{
+		auto e = ptr->As<ReturnExpression>();
+		e->Result = FoldExpr(e->Result);
+		return ptr;
+	}
+
+	case ExpressionKind_For:
+	{
+		auto e = ptr->As<ForExpression>();
+		auto mark = m_Locals.size();
+		e->From = FoldExpr(e->From);
+		e->To = FoldExpr(e->To);
+		e->Step = FoldExpr(e->Step);
+		// the body may run after its own assignments to globals
+		Invalidate();
+		if (e->Id) m_Locals.push_back(e->Id);
+		e->Body = FoldExpr(e->Body);
+		m_Locals.resize(mark);
+		return ptr;
+	}
+
+	case ExpressionKind_While:
+	{
+		auto e = ptr->As<WhileExpression>();
+		Invalidate();
+		e->Condition = FoldExpr(e->Condition);
+		e->Body = FoldExpr(e->Body);
+		return ptr;
+	}
+
+	case ExpressionKind_If:
+	{
+		auto e = ptr->As<IfExpression>();
+		e->Condition = FoldExpr(e->Condition);
+		e->BranchTrue = FoldExpr(e->BranchTrue);
+		e->BranchFalse = FoldExpr(e->BranchFalse);
+		return ptr;
+	}
+
+	case ExpressionKind_Group:
+	{
+		auto e = ptr->As<GroupExpression>();
+		auto mark = m_Locals.size();
+		for (auto &element : e->Body) element = FoldExpr(element);
+		m_Locals.resize(mark);
+		return ptr;
+	}
+
+	case ExpressionKind_Binary: return FoldBinary(*ptr->As<BinaryExpression>());
+
+	case ExpressionKind_Call:
+	{
+		auto e = ptr->As<CallExpression>();
+		for (auto &arg : e->Args) arg = FoldExpr(arg);
+		Invalidate();
+		return ptr;
+	}
+
+	case ExpressionKind_Index:
+	{
+		auto e = ptr->As<IndexExpression>();
+		e->Array = FoldExpr(e->Array);
+		e->Index = FoldExpr(e->Index);
+		return ptr;
+	}
+
+	case ExpressionKind_Member:
+	{
+		auto e = ptr->As<MemberExpression>();
+		e->Object = FoldExpr(e->Object);
+		return ptr;
+	}
+
+	case ExpressionKind_ID:
+	{
+		auto e = ptr->As<IDExpression>();
+		if (m_InFunction || std::find(m_Locals.begin(), m_Locals.end(), e->MName) != m_Locals.end()) return ptr;
+
+		auto it = m_Globals.find(e->MName);
+		if (it == m_Globals.end()) return ptr;
+		return New(e->Location, it->second->Type, it->second->Integer, it->second->Value);
+	}
+
+	case ExpressionKind_Unary:
+	{
+		auto e = ptr->As<UnaryExpression>();
+		e->Operand = FoldExpr(e->Operand);
+
+		auto operand = GetConstant(e->Operand);
+		if (!operand) return ptr;
+
+		if (e->Operator == "!") return New(e->Location, Type::GetI1(), to_bool(operand) ? -1 : 0, 0);
+		if (e->Operator == "-" && !operand->Type)
+		{
+			if (operand->IsInteger) return untyped(New(e->Location, Type::GetI64(), (int64_t) -(uint64_t) operand->Integer, 0));
+			return untyped(New(e->Location, Type::GetF64(), 0, -operand->Value));
+		}
+		if (e->Operator == "-")
+		{
+			if (auto width = int_width(operand->Type)) return New(e->Location, operand->Type, wrap(-(uint64_t) operand->Integer, width), 0);
+			if (is_float(operand->Type)) return New(e->Location, operand->Type, 0, -operand->Value);
+		}
+		return ptr;
+	}
+
+	case ExpressionKind_Object:
+	{
+		auto e = ptr->As<ObjectExpression>();
+		for (auto &init : e->Init) init = FoldExpr(init);
+		return ptr;
+	}
+
+	case ExpressionKind_Array:
+	{
+		auto e = ptr->As<ArrayExpression>();
+		e->Size = FoldExpr(e->Size);
+		e->Init = FoldExpr(e->Init);
+		return ptr;
+	}
+
+	case ExpressionKind_Sync:
+	{
+		auto e = ptr->As<SyncExpression>();
+		e->Future = FoldExpr(e->Future);
+		// the spawned call ran concurrently up to here
+		Invalidate();
+		return ptr;
+	}
+
+	default: return ptr;
+	}
+}
+
+tpp::ExprPtr tpp::Folder::FoldBinary(BinaryExpression &e)
+{
+	const auto &info = GetInfo(e.Operator);
+
+	if (e.Operator == BinaryOp_Assign || info.Base)
+	{
+		// the destination has to stay an lvalue
+		if (!e.Lhs->As<IDExpression>()) e.Lhs = FoldExpr(e.Lhs);
+		e.Rhs = FoldExpr(e.Rhs);
+		if (auto id = e.Lhs->As<IDExpression>(); id && !m_InFunction) m_Globals.erase(id->MName);
+		return &e;
+	}
+
+	e.Lhs = FoldExpr(e.Lhs);
+	e.Rhs = FoldExpr(e.Rhs);
+
+	auto lhs = GetConstant(e.Lhs);
+	auto rhs = GetConstant(e.Rhs);
+
+	if (e.Operator == BinaryOp_LAnd || e.Operator == BinaryOp_LOr)
+	{
+		// a deciding left operand means the right one is never evaluated
+		bool is_and = e.Operator == BinaryOp_LAnd;
+		if (lhs && to_bool(lhs) != is_and) return New(e.Location, Type::GetI1(), is_and ? 0 : -1, 0);
+		if (lhs && rhs) return New(e.Location, Type::GetI1(), to_bool(rhs) ? -1 : 0, 0);
+		return &e;
+	}
+
+	if (!lhs || !rhs) return &e;
+	if (auto result = Evaluate(e, lhs, rhs)) return result;
+	return &e;
+}
+
+tpp::NumberExpression *tpp::Folder::GetConstant(const ExprPtr &ptr)
+{
+	if (!ptr) return nullptr;
+	if (auto number = ptr->As<NumberExpression>()) return number;
+	if (auto chr = ptr->As<CharExpression>()) return New(chr->Location, Type::GetI8(), (signed char) chr->Value, 0);
+	return nullptr;
+}
+
+tpp::NumberExpression *tpp::Folder::Cast(NumberExpression *value, const TypePtr &type)
+{
+	if (value->Type == type) return value;
+
+	// unsuffixed literals hold a 64 bit integer or a double
+	auto source = value->Type ? value->Type : value->IsInteger ? Type::GetI64() : Type::GetF64();
+	auto from = int_width(source);
+	auto to = int_width(type);
+
+	if (from && to) return New(value->Location, type, wrap(value->Integer, to), 0);
+	if (from && is_float(type)) return New(value->Location, type, 0, round_to(type, (double) value->Integer));
+	if (is_float(source) && is_float(type)) return New(value->Location, type, 0, round_to(type, value->Value));
+
+	if (is_float(source) && to)
+	{
+		// out of range conversions are poison, leave them to run time
+		auto limit = std::ldexp(1.0, to - 1);
+		if (!(value->Value > -limit - 1 && value->Value < limit)) return nullptr;
+		return New(value->Location, type, (int64_t) value->Value, 0);
+	}
+
+	return nullptr;
+}
+
+tpp::NumberExpression *tpp::Folder::Evaluate(const BinaryExpression &e, NumberExpression *lhs, NumberExpression *rhs)
+{
+	if (!lhs->Type && !rhs->Type)
+	{
+		auto type = lhs->IsInteger && rhs->IsInteger ? Type::GetI64() : Type::GetF64();
+		auto result = Evaluate(e, Cast(lhs, type), Cast(rhs, type));
+		return result && result->Type == type ? untyped(result) : result;
+	}
+
+	if (!lhs->Type) lhs = Cast(lhs, lhs->GetType(rhs->Type));
+	if (!rhs->Type) rhs = Cast(rhs, rhs->GetType(lhs->Type));
+	if (!lhs || !rhs) return nullptr;
+
+	auto type = get_higher_order(lhs->Type, rhs->Type);
+	if (!type) return nullptr;
+
+	lhs = Cast(lhs, type);
+	rhs = Cast(rhs, type);
+	if (!lhs || !rhs) return nullptr;
+
+	auto boolean = [&](bool value) { return New(e.Location, Type::GetI1(), value ? -1 : 0, 0); };
+
+	if (auto width = int_width(type))
+	{
+		auto a = lhs->Integer, b = rhs->Integer;
+		auto integer = [&](uint64_t value) { return New(e.Location, type, wrap(value, width), 0); };
+		// division by zero, overflowing division and too wide shifts are undefined, so they are not folded
+		bool overflow = a == wrap(uint64_t(1) << (width - 1), width) && b == -1;
+		bool shift = b >= 0 && b < width;
+		uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+
+		switch (e.Operator)
+		{
+		case BinaryOp_LT: return boolean(a < b);
+		case BinaryOp_GT: return boolean(a > b);
+		case BinaryOp_LE: return boolean(a <= b);
+		case BinaryOp_GE: return boolean(a >= b);
+		case BinaryOp_EQ: return boolean(a == b);
+		case BinaryOp_NE: return boolean(a != b);
+		case BinaryOp_And: return integer(a & b);
+		case BinaryOp_Or: return integer(a | b);
+		case BinaryOp_Xor: return integer(a ^ b);
+		case BinaryOp_Shl: return shift ? integer((uint64_t) a << b) : nullptr;
+		case BinaryOp_AShr: return shift ? integer(a >> b) : nullptr;
+		case BinaryOp_LShr: return shift ? integer(((uint64_t) a & mask) >> b) : nullptr;
+		case BinaryOp_Add: return integer((uint64_t) a + (uint64_t) b);
+		case BinaryOp_Sub: return integer((uint64_t) a - (uint64_t) b);
+		case BinaryOp_Mul: return integer((uint64_t) a * (uint64_t) b);
+		case BinaryOp_Div: return b && !overflow ? integer(a / b) : nullptr;
+		case BinaryOp_Rem: return b && !overflow ? integer(a % b) : nullptr;
+		default: return nullptr;
+		}
+	}
+
+	auto a = lhs->Value, b = rhs->Value;
+	auto floating = [&](double value) { return New(e.Location, type, 0, round_to(type, value)); };
+
+	// comparisons are ordered, nan compares false
+	switch (e.Operator)
+	{
+	case BinaryOp_LT: return boolean(a < b);
+	case BinaryOp_GT: return boolean(a > b);
+	case BinaryOp_LE: return boolean(a <= b);
+	case BinaryOp_GE: return boolean(a >= b);
+	case BinaryOp_EQ: return boolean(a == b);
+	case BinaryOp_NE: return boolean(a < b || a > b);
+	case BinaryOp_Add: return floating(a + b);
+	case BinaryOp_Sub: return floating(a - b);
+	case BinaryOp_Mul: return floating(a * b);
+	case BinaryOp_Div: return floating(a / b);
+	case BinaryOp_Rem: return floating(std::fmod(a, b));
+	default: return nullptr;
+	}
+}
+
+tpp::NumberExpression *tpp::Folder::New(const SourceLocation &location, const TypePtr &type, int64_t integer, double value) { return m_Arena.New<NumberExpression>(location, type, int_width(type) != 0, integer, value); }
+
+void tpp::Folder::Invalidate()
+{
+	if (!m_InFunction) m_Globals.clear();
+}
@@ -0,0 +1,18 @@
+#include <TPP/Frontend/LoopHints.hpp>
+
+std::ostream &tpp::operator<<(std::ostream &out, const LoopHints &hints)
+{
+	if (hints.Vectorize)
+	{
+		out << "@vectorize";
+		if (hints.VectorizeWidth) out << '(' << hints.VectorizeWidth << ')';
+		out << ' ';
+	}
+	if (hints.Unroll)
+	{
+		out << "@unroll";
+		if (hints.UnrollCount) out << '(' << hints.UnrollCount << ')';
+		out << ' ';
+	}
+	return out;
+}
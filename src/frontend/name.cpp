@@ -1,33 +1,36 @@
 #include <TPP/Frontend/Name.hpp>
+#include <algorithm>
 
-static std::vector<std::string> split(const std::string &str, const std::string delim)
+tpp::Name::Name() {}
+
+tpp::Name::Name(const char *name) : Name(std::string_view(name)) {}
+
+tpp::Name::Name(std::string_view name)
 {
-	std::vector<std::string> path;
-	std::string cpy = str;
-	for (size_t pos; (pos = cpy.find(delim)) != std::string::npos;)
+	for (size_t pos; (pos = name.find(':')) != std::string_view::npos;)
 	{
-		path.push_back(cpy.substr(0, pos));
-		cpy = cpy.substr(pos + delim.size());
+		Append(Symbol::Get(name.substr(0, pos)));
+		name = name.substr(pos + 1);
 	}
-	if (!cpy.empty()) path.push_back(cpy);
-	return path;
+	if (!name.empty()) Append(Symbol::Get(name));
 }
 
-tpp::Name::Name() {}
-
-tpp::Name::Name(const char *name) : Name(std::string(name)) {}
+tpp::Name::Name(const std::string &name) : Name(std::string_view(name)) {}
 
-tpp::Name::Name(const std::string &name) : Name(split(name, ":")) {}
+tpp::Name::Name(Symbol name) { Append(name); }
 
-tpp::Name::Name(const std::vector<std::string> &path) : Path(path) {}
+tpp::Name::Name(const Name &ns, Symbol name) : Path(ns.Path), Hash(ns.Hash) { Append(name); }
 
-tpp::Name::Name(const std::vector<std::string> &ns, const std::string &name) : Path(ns) { Path.push_back(name); }
-
-tpp::Name::Name(const Name &ns, const std::string &name) : Path(ns.Path) { Path.push_back(name); }
+tpp::Name::Name(const std::vector<Symbol> &ns, const Name &name)
+{
+	for (auto symbol : ns) Append(symbol);
+	for (auto symbol : name.Path) Append(symbol);
+}
 
-tpp::Name::Name(const std::vector<std::string> &ns, const Name &name) : Path(ns)
+void tpp::Name::Append(Symbol symbol)
 {
-	for (const auto &p : name.Path) Path.push_back(p);
+	Path.push_back(symbol);
+	Hash = Hash * 31 + symbol.Id + 1;
 }
 
 std::string tpp::Name::String() const
@@ -36,13 +39,34 @@ std::string tpp::Name::String() const
 	for (size_t i = 0; i < Path.size(); ++i)
 	{
 		if (i > 0) str += ':';
-		str += Path[i];
+		str += Path[i].String();
 	}
 	return str;
 }
 
+tpp::Name tpp::Name::Namespace() const
+{
+	Name ns;
+	for (size_t i = 0; i + 1 < Path.size(); ++i) ns.Append(Path[i]);
+	return ns;
+}
+
+tpp::Symbol tpp::Name::Head() const { return Path.empty() ? Symbol() : Path.back(); }
+
 bool tpp::Name::operator!() const { return Path.empty(); }
 
-bool tpp::operator<(const Name &a, const Name &b) { return a.Path < b.Path; }
+bool tpp::operator==(const Name &a, const Name &b) { return a.Hash == b.Hash && a.Path == b.Path; }
+
+bool tpp::operator!=(const Name &a, const Name &b) { return !(a == b); }
+
+bool tpp::operator<(const Name &a, const Name &b) { return std::lexicographical_compare(a.Path.begin(), a.Path.end(), b.Path.begin(), b.Path.end()); }
 
-std::ostream &tpp::operator<<(std::ostream &out, const Name &name) { return out << name.String(); }
+std::ostream &tpp::operator<<(std::ostream &out, const Name &name)
+{
+	for (size_t i = 0; i < name.Path.size(); ++i)
+	{
+		if (i > 0) out << ':';
+		out << name.Path[i];
+	}
+	return out;
+}
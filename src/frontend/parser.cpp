@@ -1,41 +1,291 @@
+#include <TPP/Frontend/AstCache.hpp>
+#include <TPP/Frontend/DependencyGraph.hpp>
 #include <TPP/Frontend/Expression.hpp>
 #include <TPP/Frontend/Frontend.hpp>
 #include <TPP/Frontend/Parser.hpp>
+#include <TPP/Frontend/Profiler.hpp>
 #include <TPP/Frontend/SourceLocation.hpp>
 #include <TPP/Frontend/StructElement.hpp>
 #include <TPP/Frontend/Type.hpp>
-#include <fstream>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
-std::map<std::string, unsigned> tpp::Parser::PRECEDENCES = {
-	{ "=", 0 },	 { "<<=", 0 }, { ">>=", 0 }, { ">>>=", 0 }, { "+=", 0 },  { "-=", 0 }, { "*=", 0 }, { "/=", 0 }, { "%=", 0 }, { "&=", 0 },
-	{ "|=", 0 }, { "^=", 0 },  { "&&", 1 },	 { "||", 1 },	{ "<", 2 },	  { ">", 2 },  { "<=", 2 }, { ">=", 2 }, { "==", 2 }, { "&", 3 },
-	{ "|", 3 },	 { "^", 3 },   { "<<", 4 },	 { ">>", 4 },	{ ">>>", 4 }, { "+", 5 },  { "-", 5 },	{ "*", 6 },	 { "/", 6 },  { "%", 6 },
+std::string tpp::Parser::Unescape(std::string_view value)
+{
+	std::string result;
+	result.reserve(value.size());
+
+	for (size_t i = 0; i < value.size(); ++i)
+	{
+		if (value[i] != '\\' || i + 1 >= value.size())
+		{
+			result += value[i];
+			continue;
+		}
+
+		auto chr = value[++i];
+		switch (chr)
+		{
+		case 'a': chr = '\a'; break;
+		case 'b': chr = '\b'; break;
+		case 'e': chr = '\e'; break;
+		case 'f': chr = '\f'; break;
+		case 'n': chr = '\n'; break;
+		case 'r': chr = '\r'; break;
+		case 't': chr = '\t'; break;
+		case 'v': chr = '\v'; break;
+		case 'u':
+			chr = (char) std::stoi(std::string(value.substr(i + 1, 4)), 0, 16);
+			i += 4;
+			break;
+		case 'x':
+			chr = (char) std::stoi(std::string(value.substr(i + 1, 2)), 0, 16);
+			i += 2;
+			break;
+		}
+		result += chr;
+	}
+
+	return result;
+}
+
+struct tpp::ParseItem
+{
+	// the factories spell out every member; the values are the same as with a partial brace-init, but -Wmissing-field-initializers stays quiet
+	static ParseItem OfExpr(ExprPtr expr) { return { std::move(expr), nullptr, {}, {} }; }
+	static ParseItem OfInclude(ParseUnit *include) { return { nullptr, include, {}, {} }; }
+	static ParseItem OfStruct(const Symbol &name, const std::vector<StructElement> &elements) { return { nullptr, nullptr, name, elements }; }
+
+	ExprPtr Expr;
+	ParseUnit *Include;
+	Symbol Name;
+	std::vector<StructElement> Elements;
+};
+
+struct tpp::ParseUnit
+{
+	explicit ParseUnit(const std::filesystem::path &path) : Path(path), Done(Promise.get_future().share()) {}
+
+	std::filesystem::path Path;
+	Arena Exprs;
+	Arena Structs;
+	std::vector<ParseItem> Items;
+
+	std::promise<void> Promise;
+	std::shared_future<void> Done;
+};
+
+struct tpp::ParseSession
+{
+	ParseSession(unsigned jobs, AstCache *cache, DependencyGraph *graph) : Cache(cache), Graph(graph), Pool(llvm::hardware_concurrency(jobs)) {}
+
+	AstCache *Cache;
+	DependencyGraph *Graph;
+
+	// canonical path -> unit, sharded so that workers discovering includes rarely contend
+	struct Shard
+	{
+		std::mutex Mutex;
+		std::unordered_map<std::string, std::unique_ptr<ParseUnit>> Units;
+	};
+
+	Shard Shards[16];
+	std::unordered_set<ParseUnit *> Delivered;
+
+	// declared last, so it joins its workers before the units go away
+	llvm::ThreadPool Pool;
 };
 
-void tpp::Parser::ParseFile(const std::filesystem::path &filepath, std::vector<std::filesystem::path> &parsed, const TPPCallback &callback)
+void tpp::Parser::ParseFile(const std::filesystem::path &filepath, std::unordered_set<std::string> &parsed, Arena *arena, const TPPCallback &callback, AstCache *cache, DependencyGraph *graph)
 {
 	auto fp = std::filesystem::canonical(filepath);
+	if (!parsed.insert(fp.string()).second) return;
+
+	ProfileScope scope(ProfilePhase_ParseFile, [&fp] { return fp.string(); });
 
-	if (std::find(parsed.begin(), parsed.end(), fp) != parsed.end()) return;
-	parsed.push_back(fp);
+	if (graph) graph->Deliver(fp);
+	auto interface = graph ? &graph->Add(fp) : nullptr;
+
+	if (auto reader = cache ? cache->Open(fp) : nullptr)
+	{
+		Arena local;
+		auto &exprs = arena ? *arena : local;
+		for (AstItem item; reader->Next(item, exprs, Type::GetArena(), false);)
+		{
+			switch (item.Kind)
+			{
+			case AstItemKind_Include:
+				if (interface) interface->Include(item.Include);
+				ParseFile(item.Include, parsed, arena, callback, cache, graph);
+				break;
+			case AstItemKind_Struct:
+				if (interface) interface->Struct(item.Name, item.Elements);
+				Type::CreateStruct(item.Name, item.Elements);
+				break;
+			default:
+				if (interface) interface->Expr(item.Expr);
+				callback(item.Expr);
+				local.Reset();
+				break;
+			}
+		}
+		return;
+	}
 
-	std::ifstream stream(fp);
-	if (!stream.is_open()) error(SourceLocation::UNKNOWN, "failed to open file: %s", fp.string().c_str());
-	Parser parser(stream, fp, parsed, callback);
-	for (ExprPtr expression; (expression = parser.GetNext());) { callback(expression); }
+	auto buffer = llvm::MemoryBuffer::getFile(fp.string(), false, false);
+	if (!buffer) error(SourceLocation::UNKNOWN, "failed to open file: %s", fp.string().c_str());
+	AstWriter writer;
+	Parser parser((*buffer)->getBuffer(), fp, arena);
+	parser.m_Parsed = &parsed;
+	parser.m_Callback = &callback;
+	parser.m_Cache = cache;
+	parser.m_Writer = cache ? &writer : nullptr;
+	parser.m_Graph = graph;
+	parser.m_Interface = interface;
+	for (ExprPtr expression; (expression = parser.GetNext());)
+	{
+		if (cache) writer.Expr(expression);
+		if (interface) interface->Expr(expression);
+		callback(expression);
+		// without a caller-provided arena the expression dies with the callback
+		if (!arena) parser.m_ExprArena.Reset();
+	}
+	if (cache) cache->Store(fp, std::move(writer));
 }
 
-void tpp::Parser::ParseFile(const std::filesystem::path &filepath, const TPPCallback &callback)
+void tpp::Parser::ParseFile(const std::filesystem::path &filepath, Arena *arena, const TPPCallback &callback, unsigned jobs, AstCache *cache, DependencyGraph *graph)
 {
-	std::vector<std::filesystem::path> parsed;
-	ParseFile(filepath, parsed, callback);
+	if (jobs == 1)
+	{
+		std::unordered_set<std::string> parsed;
+		ParseFile(filepath, parsed, arena, callback, cache, graph);
+	}
+	else
+	{
+		ParseSession session(jobs, cache, graph);
+		auto root = Enqueue(session, filepath);
+		session.Delivered.insert(root);
+		Deliver(session, *root, arena, callback);
+	}
+
+	if (cache) cache->Flush();
 }
 
-tpp::Parser::Parser(std::istream &stream, const std::filesystem::path &filepath, std::vector<std::filesystem::path> &parsed, const TPPCallback &callback)
-	: m_Filepath(filepath), m_Parsed(parsed), m_Callback(callback), m_Location{ filepath, 1, 0 }, m_Stream(stream)
+void tpp::Parser::ParseFile(ParseSession &session, ParseUnit &unit)
+{
+	ProfileThread thread;
+	ProfileScope scope(ProfilePhase_ParseFile, [&unit] { return unit.Path.string(); });
+
+	auto interface = session.Graph ? &session.Graph->Add(unit.Path) : nullptr;
+
+	if (auto reader = session.Cache ? session.Cache->Open(unit.Path) : nullptr)
+	{
+		for (AstItem item; reader->Next(item, unit.Exprs, unit.Structs, true);)
+		{
+			switch (item.Kind)
+			{
+			case AstItemKind_Include:
+				if (interface) interface->Include(item.Include);
+				unit.Items.push_back(ParseItem::OfInclude(Enqueue(session, item.Include)));
+				break;
+			case AstItemKind_Struct:
+				if (interface) interface->Struct(item.Name, item.Elements);
+				unit.Items.push_back(ParseItem::OfStruct(item.Name, item.Elements));
+				break;
+			default:
+				if (interface) interface->Expr(item.Expr);
+				unit.Items.push_back(ParseItem::OfExpr(item.Expr));
+				break;
+			}
+		}
+		unit.Promise.set_value();
+		return;
+	}
+
+	auto buffer = llvm::MemoryBuffer::getFile(unit.Path.string(), false, false);
+	if (!buffer) error(SourceLocation::UNKNOWN, "failed to open file: %s", unit.Path.string().c_str());
+	AstWriter writer;
+	Parser parser((*buffer)->getBuffer(), unit.Path, &unit.Exprs);
+	parser.m_Session = &session;
+	parser.m_Unit = &unit;
+	parser.m_Cache = session.Cache;
+	parser.m_Writer = session.Cache ? &writer : nullptr;
+	parser.m_Graph = session.Graph;
+	parser.m_Interface = interface;
+	for (ExprPtr expression; (expression = parser.GetNext());)
+	{
+		if (session.Cache) writer.Expr(expression);
+		if (interface) interface->Expr(expression);
+		unit.Items.push_back(ParseItem::OfExpr(expression));
+	}
+	if (session.Cache) session.Cache->Store(unit.Path, std::move(writer));
+	unit.Promise.set_value();
+}
+
+tpp::ParseUnit *tpp::Parser::Enqueue(ParseSession &session, const std::filesystem::path &filepath)
+{
+	auto fp = std::filesystem::canonical(filepath);
+	auto key = fp.string();
+	auto &shard = session.Shards[std::hash<std::string>()(key) % std::size(session.Shards)];
+
+	ParseUnit *unit;
+	{
+		std::lock_guard lock(shard.Mutex);
+		auto &ref = shard.Units[key];
+		if (ref) return ref.get();
+		ref = std::make_unique<ParseUnit>(fp);
+		unit = ref.get();
+	}
+
+	session.Pool.async([&session, unit] { ParseFile(session, *unit); });
+	return unit;
+}
+
+void tpp::Parser::Deliver(ParseSession &session, ParseUnit &unit, Arena *arena, const TPPCallback &callback)
+{
+	// same order as the streaming parser: an include is expanded where it first appears depth-first
+	unit.Done.wait();
+	if (session.Graph) session.Graph->Deliver(unit.Path);
+	for (auto &item : unit.Items)
+	{
+		if (item.Include)
+		{
+			if (session.Delivered.insert(item.Include).second) Deliver(session, *item.Include, arena, callback);
+		}
+		else if (item.Expr) callback(item.Expr);
+		else Type::CreateStruct(item.Name, item.Elements);
+	}
+
+	Type::GetArena().Adopt(std::move(unit.Structs));
+	if (arena) arena->Adopt(std::move(unit.Exprs));
+	else unit.Exprs.Reset();
+}
+
+void tpp::Parser::ParseFile(const std::filesystem::path &filepath, const TPPCallback &callback, unsigned jobs, AstCache *cache, DependencyGraph *graph) { ParseFile(filepath, nullptr, callback, jobs, cache, graph); }
+
+void tpp::Parser::ParseFile(const std::filesystem::path &filepath, Arena &arena, const TPPCallback &callback, unsigned jobs, AstCache *cache, DependencyGraph *graph) { ParseFile(filepath, &arena, callback, jobs, cache, graph); }
+
+size_t tpp::Parser::CountTokens(std::string_view source, const std::filesystem::path &filepath)
+{
+	Parser parser(source, filepath, nullptr);
+	size_t count = 0;
+	for (; !parser.AtEOF(); parser.Next()) ++count;
+	return count;
+}
+
+tpp::Parser::Parser(std::string_view source, const std::filesystem::path &filepath, Arena *arena)
+	: m_Filepath(SourceLocation::Intern(filepath)), m_Arena(arena ? arena : &m_ExprArena), m_Ptr(source.data()), m_End(source.data() + source.size()), m_LineStart(source.data())
 {
 	Next();
 }
@@ -44,7 +294,7 @@ tpp::ExprPtr tpp::Parser::GetNext()
 {
 	while (!AtEOF())
 	{
-		if (At("include"))
+		if (At(Keyword_Include))
 		{
 			ParseInclude();
 			continue;
@@ -54,203 +304,127 @@ tpp::ExprPtr tpp::Parser::GetNext()
 			ParseNamespace();
 			continue;
 		}
-		if (At("struct"))
+		if (At(Keyword_Struct))
 		{
 			ParseStruct();
 			continue;
 		}
+
+		ProfileScope scope(ProfilePhase_Parse, [this] { return m_Filepath->string() + ":" + std::to_string(m_Token.Row); });
 		return Parse();
 	}
 
 	return {};
 }
 
-int tpp::Parser::Get()
+void tpp::Parser::NewLine(const char *line_start)
 {
-	++m_Location.Column;
-	return m_Stream.get();
+	m_LineStart = line_start;
+	++m_Row;
 }
 
-void tpp::Parser::Escape()
+static bool isOp(int chr)
 {
-	if (chr != '\\') return;
+	return chr == '+' || chr == '-' || chr == '*' || chr == '/' || chr == '%' || chr == '&' || chr == '|' || chr == '^' || chr == '=' || chr == '<' || chr == '>' || chr == '?' || chr == '!';
+}
 
-	chr = Get();
-	switch (chr)
-	{
-	case 'a': chr = '\a'; break;
-	case 'b': chr = '\b'; break;
-	case 'e': chr = '\e'; break;
-	case 'f': chr = '\f'; break;
-	case 'n': chr = '\n'; break;
-	case 'r': chr = '\r'; break;
-	case 't': chr = '\t'; break;
-	case 'v': chr = '\v'; break;
-	case 'u':
-	{
-		std::string value;
-		for (unsigned i = 0; i < 4; ++i)
-		{
-			chr = Get();
-			value += (char) chr;
-		}
-		chr = std::stoi(value, 0, 16);
-		break;
-	}
-	case 'x':
+static bool isId(int chr) { return isalnum(chr) || chr == '_'; }
+
+void tpp::Parser::SkipSpace()
+{
+	while (m_Ptr < m_End)
 	{
-		std::string value;
-		for (unsigned i = 0; i < 2; ++i)
+		if ((unsigned char) *m_Ptr <= 0x20)
 		{
-			chr = Get();
-			value += (char) chr;
+			if (*m_Ptr++ == '\n') NewLine(m_Ptr);
+			continue;
 		}
-		chr = std::stoi(value, 0, 16);
-		break;
-	}
-	}
-}
 
-void tpp::Parser::NewLine()
-{
-	m_Location.Column = 0;
-	++m_Location.Row;
-}
+		if (*m_Ptr != '#') return;
 
-static bool isOp(int chr)
-{
-	return chr == '+' || chr == '-' || chr == '*' || chr == '/' || chr == '%' || chr == '&' || chr == '|' || chr == '^' || chr == '=' || chr == '<' || chr == '>' || chr == '?';
+		// comments run from '#' to the next '#'
+		for (++m_Ptr; m_Ptr < m_End && *m_Ptr != '#';)
+			if (*m_Ptr++ == '\n') NewLine(m_Ptr);
+		if (m_Ptr < m_End) ++m_Ptr;
+	}
 }
 
 tpp::Token &tpp::Parser::Next()
 {
-	if (chr < 0) chr = Get();
+	ProfileScope scope(ProfilePhase_Lex, false);
 
-	while (0x00 <= chr && chr <= 0x20)
-	{
-		if (chr == '\n') NewLine();
-		chr = Get();
-	}
+	SkipSpace();
+	if (m_Ptr >= m_End) return m_Token = {};
 
-	auto mode = ParserMode_Normal;
-	std::string value;
-	SourceLocation loc;
+	auto begin = m_Ptr;
+	auto row = m_Row;
+	auto column = (size_t) (begin - m_LineStart) + 1;
+	auto chr = (unsigned char) *m_Ptr;
 
-	while (chr >= 0)
+	if (chr == '"' || chr == '\'')
 	{
-		switch (mode)
+		auto delim = *m_Ptr++;
+		for (begin = m_Ptr; m_Ptr < m_End && *m_Ptr != delim; ++m_Ptr)
 		{
-		case ParserMode_Normal:
-			switch (chr)
-			{
-			case '#': mode = ParserMode_Comment; break;
-
-			case '"':
-				loc = m_Location;
-				mode = ParserMode_String;
-				break;
-
-			case '\'':
-				loc = m_Location;
-				mode = ParserMode_Char;
-				break;
-
-			default:
-				if (chr <= 0x20)
-				{
-					if (chr == '\n') NewLine();
-					break;
-				}
-
-				if (isdigit(chr))
-				{
-					loc = m_Location;
-					mode = ParserMode_Number;
-					value += (char) chr;
-					break;
-				}
-
-				if (isalnum(chr) || chr == '_')
-				{
-					loc = m_Location;
-					mode = ParserMode_Id;
-					value += (char) chr;
-					break;
-				}
-
-				if (isOp(chr))
-				{
-					loc = m_Location;
-					mode = ParserMode_BinaryOperator;
-					value += (char) chr;
-					break;
-				}
-
-				loc = m_Location;
-				value += (char) chr;
-				chr = Get();
-				return m_Token = { loc, TokenType_Other, value };
-			}
-			break;
-
-		case ParserMode_Comment:
-			if (chr == '#') { mode = ParserMode_Normal; }
-			break;
-
-		case ParserMode_String:
-			if (chr == '"')
-			{
-				chr = Get();
-				return m_Token = { loc, TokenType_String, value };
-			}
-			if (chr == '\\') { Escape(); }
-			value += (char) chr;
-			break;
-
-		case ParserMode_Char:
-			if (chr == '\'')
-			{
-				chr = Get();
-				return m_Token = { loc, TokenType_Char, value };
-			}
-			if (chr == '\\') { Escape(); }
-			value += (char) chr;
-			break;
-
-		case ParserMode_Number:
-			if (chr == '.')
-			{
-				value += (char) chr;
-				break;
-			}
-			if (!isdigit(chr)) return m_Token = { loc, TokenType_Number, value };
-			value += (char) chr;
-			break;
-
-		case ParserMode_Id:
-			if (!isalnum(chr) && chr != '_') return m_Token = { loc, TokenType_Id, value };
-			value += (char) chr;
-			break;
-
-		case ParserMode_BinaryOperator:
-			if (!isOp(chr)) return m_Token = { loc, TokenType_BinaryOperator, value };
-			value += (char) chr;
-			break;
-
-		default: break;
+			if (*m_Ptr == '\\' && m_Ptr + 1 < m_End) ++m_Ptr;
+			if (*m_Ptr == '\n') NewLine(m_Ptr + 1);
 		}
+		std::string_view value(begin, m_Ptr - begin);
+		if (m_Ptr < m_End) ++m_Ptr;
+		return m_Token = { delim == '"' ? TokenType_String : TokenType_Char, value, {}, {}, row, column };
+	}
 
-		chr = Get();
+	TokenType type;
+	if (isdigit(chr))
+	{
+		type = TokenType_Number;
+		// 0x and 0b integers, or decimals with an optional fraction and exponent; a type suffix like i32 or f32 is part of the token
+		if (chr == '0' && m_Ptr + 2 < m_End && m_Ptr[1] && strchr("xXbB", m_Ptr[1]) && isxdigit((unsigned char) m_Ptr[2]))
+		{
+			for (m_Ptr += 2; m_Ptr < m_End && isxdigit((unsigned char) *m_Ptr);) ++m_Ptr;
+		}
+		else
+		{
+			while (m_Ptr < m_End && (isdigit((unsigned char) *m_Ptr) || *m_Ptr == '.')) ++m_Ptr;
+			if (m_Ptr + 1 < m_End && (*m_Ptr == 'e' || *m_Ptr == 'E') && (isdigit((unsigned char) m_Ptr[1]) || ((m_Ptr[1] == '+' || m_Ptr[1] == '-') && m_Ptr + 2 < m_End && isdigit((unsigned char) m_Ptr[2]))))
+				for (m_Ptr += 2; m_Ptr < m_End && isdigit((unsigned char) *m_Ptr);) ++m_Ptr;
+		}
+		while (m_Ptr < m_End && isId((unsigned char) *m_Ptr)) ++m_Ptr;
+	}
+	else if (isId(chr))
+	{
+		type = TokenType_Id;
+		while (m_Ptr < m_End && isId((unsigned char) *m_Ptr)) ++m_Ptr;
+	}
+	else if (isOp(chr))
+	{
+		type = TokenType_BinaryOperator;
+		// '!' only goes on into '!=', otherwise it is the prefix operator on its own, also right after another operator as in 'a=!b'
+		if (chr == '!') m_Ptr += m_Ptr + 1 < m_End && m_Ptr[1] == '=' ? 2 : 1;
+		else
+			while (m_Ptr < m_End && isOp((unsigned char) *m_Ptr) && *m_Ptr != '!') ++m_Ptr;
+	}
+	else
+	{
+		type = TokenType_Other;
+		++m_Ptr;
 	}
 
-	return m_Token = {};
+	std::string_view value(begin, m_Ptr - begin);
+	auto sym = type == TokenType_Id ? Symbol::Get(value) : Symbol();
+	auto op = type == TokenType_BinaryOperator ? ToBinaryOp(value) : BinaryOp_;
+	return m_Token = { type, value, sym, op, row, column };
 }
 
+tpp::SourceLocation tpp::Parser::Location() const { return { m_Filepath, m_Token.Row, m_Token.Column }; }
+
 bool tpp::Parser::AtEOF() { return !m_Token.Type; }
 
 bool tpp::Parser::At(const TokenType type) { return m_Token.Type == type; }
 
-bool tpp::Parser::At(const std::string &value) { return m_Token.Value == value; }
+bool tpp::Parser::At(std::string_view value) { return m_Token.Value == value; }
+
+bool tpp::Parser::At(Keyword keyword) { return m_Token.Type == TokenType_Id && m_Token.Sym == keyword; }
 
 bool tpp::Parser::NextIfAt(const TokenType type)
 {
@@ -262,7 +436,7 @@ bool tpp::Parser::NextIfAt(const TokenType type)
 	return false;
 }
 
-bool tpp::Parser::NextIfAt(const std::string &value)
+bool tpp::Parser::NextIfAt(std::string_view value)
 {
 	if (At(value))
 	{
@@ -272,6 +446,16 @@ bool tpp::Parser::NextIfAt(const std::string &value)
 	return false;
 }
 
+bool tpp::Parser::NextIfAt(Keyword keyword)
+{
+	if (At(keyword))
+	{
+		Next();
+		return true;
+	}
+	return false;
+}
+
 tpp::Token tpp::Parser::Expect(const TokenType type)
 {
 	if (At(type))
@@ -280,17 +464,27 @@ tpp::Token tpp::Parser::Expect(const TokenType type)
 		Next();
 		return token;
 	}
-	error(m_Token.Location, "unexpected token: %s", m_Token.Value.c_str());
+	error(Location(), "unexpected token: %.*s", (int) m_Token.Value.size(), m_Token.Value.data());
 }
 
-void tpp::Parser::Expect(const std::string &value)
+void tpp::Parser::Expect(std::string_view value)
 {
 	if (At(value))
 	{
 		Next();
 		return;
 	}
-	error(m_Token.Location, "unexpected token: %s", m_Token.Value.c_str());
+	error(Location(), "unexpected token: %.*s", (int) m_Token.Value.size(), m_Token.Value.data());
+}
+
+void tpp::Parser::Expect(Keyword keyword)
+{
+	if (At(keyword))
+	{
+		Next();
+		return;
+	}
+	error(Location(), "unexpected token: %.*s", (int) m_Token.Value.size(), m_Token.Value.data());
 }
 
 tpp::Token tpp::Parser::Skip()
@@ -302,18 +496,31 @@ tpp::Token tpp::Parser::Skip()
 
 void tpp::Parser::ParseInclude()
 {
-	Expect("include");
-	auto filename = Expect(TokenType_String).Value;
+	Expect(Keyword_Include);
+	auto filename = Unescape(Expect(TokenType_String).Value);
 	std::filesystem::path path(filename);
-	if (!path.is_absolute()) path = m_Filepath.parent_path() / filename;
+	if (!path.is_absolute()) path = m_Filepath->parent_path() / filename;
 
-	ParseFile(path, m_Parsed, m_Callback);
+	if (m_Writer || m_Interface)
+	{
+		auto include = std::filesystem::canonical(path);
+		if (m_Writer) m_Writer->Include(include);
+		if (m_Interface) m_Interface->Include(include);
+	}
+
+	if (m_Unit)
+	{
+		m_Unit->Items.push_back(ParseItem::OfInclude(Enqueue(*m_Session, path)));
+		return;
+	}
+
+	ParseFile(path, *m_Parsed, m_Arena != &m_ExprArena ? m_Arena : nullptr, *m_Callback, m_Cache, m_Graph);
 }
 
 void tpp::Parser::ParseNamespace()
 {
 	Expect(":");
-	auto name = Expect(TokenType_Id).Value;
+	auto name = Expect(TokenType_Id).Sym;
 
 	if (m_Namespace.empty() || m_Namespace.back() != name) m_Namespace.push_back(name);
 	else
@@ -322,8 +529,12 @@ void tpp::Parser::ParseNamespace()
 
 void tpp::Parser::ParseStruct()
 {
-	Expect("struct");
-	auto name = Expect(TokenType_Id).Value;
+	Expect(Keyword_Struct);
+	auto name = Expect(TokenType_Id).Sym;
+
+	// element initializers outlive the current top-level expression
+	auto backup_arena = m_Arena;
+	m_Arena = m_Unit ? &m_Unit->Structs : &Type::GetArena();
 
 	std::vector<StructElement> elements;
 	if (NextIfAt("{"))
@@ -331,42 +542,65 @@ void tpp::Parser::ParseStruct()
 		{
 			auto etype = ParseType();
 			auto ename = ParseName();
-			ExprPtr einit;
+			ExprPtr einit = nullptr;
 			if (NextIfAt("=")) einit = Parse();
 			elements.emplace_back(etype, ename, einit);
 			if (!At("}")) Expect(",");
 		}
 
-	Type::CreateStruct(name, elements);
+	m_Arena = backup_arena;
+
+	if (m_Writer) m_Writer->Struct(name, elements);
+	if (m_Interface) m_Interface->Struct(name, elements);
+
+	// a concurrently parsed file registers its structs when it is delivered, in include order
+	if (m_Unit) m_Unit->Items.push_back(ParseItem::OfStruct(name, elements));
+	else Type::CreateStruct(name, elements);
 }
 
 tpp::Name tpp::Parser::ParseName()
 {
-	std::vector<std::string> path;
-	path.push_back(Expect(TokenType_Id).Value);
+	Name name(Expect(TokenType_Id).Sym);
 
-	if (!At(":")) { return path; }
+	if (!At(":")) { return name; }
 
-	while (NextIfAt(":")) path.push_back(Expect(TokenType_Id).Value);
-	return path;
+	while (NextIfAt(":")) name.Append(Expect(TokenType_Id).Sym);
+	return name;
 }
 
 tpp::TypePtr tpp::Parser::ParseType()
 {
+	TypePtr type;
 	if (NextIfAt("["))
 	{
 		auto base = ParseType();
 		Expect("]");
-		return Type::GetArray(base);
+		type = Type::GetArray(base);
+	}
+	else if (NextIfAt(Keyword_Spawn)) return Type::GetFuture(ParseType());
+	else
+	{
+		auto name = Expect(TokenType_Id).Sym;
+		type = m_Unit ? Type::GetDeferred(name) : Type::Get(name, true);
 	}
 
-	auto name = Expect(TokenType_Id).Value;
-	return Type::Get(name, true);
+	// a constant length makes it a fixed array held by value, like f64[3]; as in c, i32[2][3] is two rows of three
+	std::vector<unsigned> lengths;
+	while (NextIfAt("["))
+	{
+		auto location = Location();
+		NumberExpression length(location, std::string(Expect(TokenType_Number).Value));
+		if (!length.IsInteger || length.Integer <= 0 || length.Integer > UINT32_MAX) error(location, "array length must be a positive integer");
+		Expect("]");
+		lengths.push_back((unsigned) length.Integer);
+	}
+	for (auto i = lengths.rbegin(); i != lengths.rend(); ++i) type = Type::GetFixedArray(type, *i);
+	return type;
 }
 
 tpp::ExprPtr tpp::Parser::Parse()
 {
-	if (At("def")) return ParseDef();
+	if (At(Keyword_Def)) return ParseDef();
 	if (At("->")) return ParseReturn();
 
 	return ParseBinary();
@@ -374,15 +608,23 @@ tpp::ExprPtr tpp::Parser::Parse()
 
 tpp::ExprPtr tpp::Parser::ParseDef()
 {
-	auto location = m_Token.Location;
-	Expect("def");
+	auto location = Location();
+	Expect(Keyword_Def);
 
 	auto type = ParseType();
 	Name name;
+	ExprPtr size = nullptr;
 
 	if (!(At("=") || At("(") || At("["))) { name = ParseName(); }
 	else
 	{
+		// without a type, the brackets of 'def x[3]' size x instead
+		if (auto fixed = type->As<FixedArrayType>())
+		{
+			if (fixed->Base->Kind == TypeKind_FixedArray) error(location, "a variable without a type takes a single length");
+			size = m_Arena->New<NumberExpression>(location, std::to_string(fixed->Count));
+			type = fixed->Base;
+		}
 		name = type->Name;
 		type = {};
 	}
@@ -404,53 +646,53 @@ tpp::ExprPtr tpp::Parser::ParseDef()
 			}
 
 			auto arg_type = ParseType();
-			auto arg_name = Expect(TokenType_Id).Value;
+			auto arg_name = Expect(TokenType_Id).Sym;
 			args.emplace_back(arg_type, arg_name);
 			if (!At(")")) Expect(",");
 		}
 
 		m_InFunction = true;
 
-		ExprPtr body;
+		ExprPtr body = nullptr;
 		if (NextIfAt("=")) body = Parse();
 
 		m_InFunction = false;
 
-		return std::make_shared<DefFunctionExpression>(location, type, name, args, var_arg, body);
+		return m_Arena->New<DefFunctionExpression>(location, type, name, args, var_arg, body);
 	}
 
-	ExprPtr size;
-	if (NextIfAt("["))
+	if (!size && NextIfAt("["))
 	{
 		size = Parse();
 		Expect("]");
 	}
 
-	ExprPtr init;
+	ExprPtr init = nullptr;
 	if (NextIfAt("=")) init = Parse();
 
-	return std::make_shared<DefVariableExpression>(location, type, name, size, init);
+	return m_Arena->New<DefVariableExpression>(location, type, name, size, init);
 }
 
 tpp::ExprPtr tpp::Parser::ParseReturn()
 {
-	auto location = m_Token.Location;
+	auto location = Location();
 	Expect("->");
 	auto result = Parse();
-	return std::make_shared<ReturnExpression>(location, result);
+	return m_Arena->New<ReturnExpression>(location, result);
 }
 
 tpp::ExprPtr tpp::Parser::ParseFor()
 {
-	auto location = m_Token.Location;
+	auto location = Location();
 
-	Expect("for");
+	bool is_parallel = NextIfAt(Keyword_PFor);
+	if (!is_parallel) Expect(Keyword_For);
 	Expect("[");
 	auto from = Parse();
 	Expect(",");
 	auto to = Parse();
 
-	ExprPtr step;
+	ExprPtr step = nullptr;
 	if (!NextIfAt("]"))
 	{
 		Expect(",");
@@ -458,68 +700,99 @@ tpp::ExprPtr tpp::Parser::ParseFor()
 		Expect("]");
 	}
 
-	std::string id;
-	if (NextIfAt(":")) id = Expect(TokenType_Id).Value;
+	Symbol id;
+	if (NextIfAt(":")) id = Expect(TokenType_Id).Sym;
 
+	auto hints = ParseLoopHints();
 	auto body = Parse();
-	return std::make_shared<ForExpression>(location, from, to, step, id, body);
+	return m_Arena->New<ForExpression>(location, is_parallel, from, to, step, id, hints, body);
 }
 
 tpp::ExprPtr tpp::Parser::ParseWhile()
 {
-	auto location = m_Token.Location;
+	auto location = Location();
 
-	Expect("while");
+	Expect(Keyword_While);
 	Expect("[");
 	auto condition = Parse();
 	Expect("]");
+	auto hints = ParseLoopHints();
 	auto body = Parse();
 
-	return std::make_shared<WhileExpression>(location, condition, body);
+	return m_Arena->New<WhileExpression>(location, condition, hints, body);
+}
+
+tpp::LoopHints tpp::Parser::ParseLoopHints()
+{
+	LoopHints hints;
+	while (At("@"))
+	{
+		auto location = Location();
+		Skip();
+		auto name = Expect(TokenType_Id);
+
+		// the count has to follow the name directly, '@unroll (' starts the loop body
+		unsigned count = 0;
+		if (At("(") && m_Token.Row == name.Row && m_Token.Column == name.Column + name.Value.size())
+		{
+			Skip();
+			auto number = Expect(TokenType_Number);
+			count = (unsigned) std::strtoul(std::string(number.Value).c_str(), nullptr, 10);
+			if (!count) error(location, "loop hint count must be positive: %.*s", (int) number.Value.size(), number.Value.data());
+			Expect(")");
+		}
+
+		if (name.Value == "vectorize") hints.Vectorize = true, hints.VectorizeWidth = count;
+		else if (name.Value == "unroll") hints.Unroll = true, hints.UnrollCount = count;
+		else error(location, "unknown loop hint: @%.*s", (int) name.Value.size(), name.Value.data());
+	}
+	return hints;
 }
 
 tpp::ExprPtr tpp::Parser::ParseIf()
 {
-	auto location = m_Token.Location;
+	auto location = Location();
 
-	Expect("if");
+	Expect(Keyword_If);
 	Expect("[");
 	auto condition = Parse();
 	Expect("]");
 	auto branchTrue = Parse();
 
 	ExprPtr branchFalse;
-	if (NextIfAt("else")) branchFalse = Parse();
+	if (NextIfAt(Keyword_Else)) branchFalse = Parse();
 
-	return std::make_shared<IfExpression>(location, condition, branchTrue, branchFalse);
+	return m_Arena->New<IfExpression>(location, condition, branchTrue, branchFalse);
 }
 
 tpp::ExprPtr tpp::Parser::ParseGroup()
 {
-	auto location = m_Token.Location;
+	auto location = Location();
 
 	Expect("(");
 	std::vector<ExprPtr> body;
 	while (!NextIfAt(")")) body.push_back(Parse());
 
-	return std::make_shared<GroupExpression>(location, body);
+	return m_Arena->New<GroupExpression>(location, body);
 }
 
 tpp::ExprPtr tpp::Parser::ParseBinary() { return ParseBinary(ParseCall(), 0); }
 
 tpp::ExprPtr tpp::Parser::ParseBinary(ExprPtr lhs, unsigned min_prec)
 {
-	while (At(TokenType_BinaryOperator) && PRECEDENCES[m_Token.Value] >= min_prec)
+	// operator tokens that do not name a binary operation ('->', '?') end the expression
+	while (m_Token.Op && GetInfo(m_Token.Op).Precedence >= min_prec)
 	{
-		auto op = Skip().Value;
-		auto op_prec = PRECEDENCES[op];
+		auto op = Skip().Op;
+		auto op_prec = GetInfo(op).Precedence;
 		auto rhs = ParseCall();
-		while (At(TokenType_BinaryOperator) && PRECEDENCES[m_Token.Value] > op_prec)
+		while (m_Token.Op)
 		{
-			auto la_prec = PRECEDENCES[m_Token.Value];
-			rhs = ParseBinary(rhs, op_prec + (la_prec > op_prec ? 1 : 0));
+			const auto &la = GetInfo(m_Token.Op);
+			if (la.Precedence < op_prec || (la.Precedence == op_prec && !la.RightAssoc)) break;
+			rhs = ParseBinary(rhs, op_prec + (la.Precedence > op_prec ? 1 : 0));
 		}
-		lhs = std::make_shared<BinaryExpression>(lhs->Location, op, lhs, rhs);
+		lhs = m_Arena->New<BinaryExpression>(lhs->Location, op, lhs, rhs);
 	}
 	return lhs;
 }
@@ -536,8 +809,10 @@ tpp::ExprPtr tpp::Parser::ParseCall()
 			if (!At(")")) Expect(",");
 		}
 
-		auto name = std::dynamic_pointer_cast<IDExpression>(callee)->MName;
-		callee = std::make_shared<CallExpression>(callee->Location, name, args);
+		auto id = callee->As<IDExpression>();
+		if (!id) error(callee->Location, "callee must be a name");
+		auto name = id->MName;
+		callee = m_Arena->New<CallExpression>(callee->Location, name, args);
 	}
 
 	return callee;
@@ -551,7 +826,7 @@ tpp::ExprPtr tpp::Parser::ParseIndex()
 		auto index = Parse();
 		Expect("]");
 
-		array = std::make_shared<IndexExpression>(array->Location, array, index);
+		array = m_Arena->New<IndexExpression>(array->Location, array, index);
 	}
 
 	return array;
@@ -563,8 +838,8 @@ tpp::ExprPtr tpp::Parser::ParseMember(ExprPtr object)
 {
 	while (NextIfAt("."))
 	{
-		auto member = Expect(TokenType_Id).Value;
-		object = std::make_shared<MemberExpression>(object->Location, object, member);
+		auto member = Expect(TokenType_Id).Sym;
+		object = m_Arena->New<MemberExpression>(object->Location, object, member);
 	}
 
 	return object;
@@ -574,52 +849,67 @@ tpp::ExprPtr tpp::Parser::ParsePrimary()
 {
 	if (AtEOF()) error(SourceLocation::UNKNOWN, "reached end of file");
 
-	auto location = m_Token.Location;
+	auto location = Location();
 
-	if (At("for")) return ParseFor();
+	if (At(Keyword_For) || At(Keyword_PFor)) return ParseFor();
 
-	if (At("while")) return ParseWhile();
+	if (At(Keyword_While)) return ParseWhile();
 
-	if (At("if")) return ParseIf();
+	if (At(Keyword_If)) return ParseIf();
+
+	if (NextIfAt(Keyword_Spawn))
+	{
+		auto call = ParseCall();
+		auto e = call->As<CallExpression>();
+		if (!e) error(call->Location, "spawn expects a call");
+		e->IsSpawn = true;
+		return call;
+	}
+
+	if (NextIfAt(Keyword_Sync))
+	{
+		auto future = ParseCall();
+		return m_Arena->New<SyncExpression>(location, future);
+	}
 
 	if (At(TokenType_Id))
 	{
 		auto name = ParseName();
-		return std::make_shared<IDExpression>(location, name);
+		return m_Arena->New<IDExpression>(location, name);
 	}
 
 	if (At(TokenType_Number))
 	{
-		auto value = Skip().Value;
-		return std::make_shared<NumberExpression>(location, value);
+		auto value = std::string(Skip().Value);
+		return m_Arena->New<NumberExpression>(location, value);
 	}
 
 	if (At(TokenType_Char))
 	{
-		auto value = Skip().Value;
-		return std::make_shared<CharExpression>(location, value);
+		auto value = Unescape(Skip().Value);
+		return m_Arena->New<CharExpression>(location, value);
 	}
 
 	if (At(TokenType_String))
 	{
-		auto value = Skip().Value;
-		return std::make_shared<StringExpression>(location, value);
+		auto value = Unescape(Skip().Value);
+		return m_Arena->New<StringExpression>(location, value);
 	}
 
 	if (At("(")) return ParseGroup();
 
-	if (NextIfAt("?")) return std::make_shared<VarArgsExpression>(location);
+	if (NextIfAt("?")) return m_Arena->New<VarArgsExpression>(location);
 
 	if (NextIfAt("!"))
 	{
 		auto operand = Parse();
-		return std::make_shared<UnaryExpression>(location, "!", operand);
+		return m_Arena->New<UnaryExpression>(location, "!", operand);
 	}
 
 	if (NextIfAt("-"))
 	{
 		auto operand = Parse();
-		return std::make_shared<UnaryExpression>(location, "-", operand);
+		return m_Arena->New<UnaryExpression>(location, "-", operand);
 	}
 
 	if (NextIfAt("{"))
@@ -630,17 +920,17 @@ tpp::ExprPtr tpp::Parser::ParsePrimary()
 			init.push_back(Parse());
 			if (!At("}")) Expect(",");
 		}
-		return std::make_shared<ObjectExpression>(location, init);
+		return m_Arena->New<ObjectExpression>(location, init);
 	}
 
 	if (NextIfAt("["))
 	{
 		auto size = Parse();
-		ExprPtr init;
+		ExprPtr init = nullptr;
 		if (NextIfAt(",")) init = Parse();
 		Expect("]");
-		return std::make_shared<ArrayExpression>(location, size, init);
+		return m_Arena->New<ArrayExpression>(location, size, init);
 	}
 
-	error(m_Token.Location, "unhandled token: %s", m_Token.Value.c_str());
+	error(Location(), "unhandled token: %.*s", (int) m_Token.Value.size(), m_Token.Value.data());
 }
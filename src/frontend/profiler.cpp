@@ -0,0 +1,123 @@
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Profiler.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <algorithm>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <vector>
+
+static constexpr const char *PHASE_NAMES[] = {
+	"parse file", "lex", "parse", "type lookup", "fold", "genir", "genir function", "verify function", "optimize function", "optimize module", "link", "emit", "jit",
+};
+
+static_assert(std::size(PHASE_NAMES) == tpp::ProfilePhase_Count);
+
+tpp::Profiler &tpp::Profiler::Global()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+void tpp::Profiler::EnableReport()
+{
+	m_Begin = std::chrono::steady_clock::now();
+	m_Report = true;
+}
+
+void tpp::Profiler::EnableTrace(unsigned granularity)
+{
+	m_Granularity = granularity;
+	m_Trace = true;
+	llvm::timeTraceProfilerInitialize(granularity, "t++");
+}
+
+bool tpp::Profiler::Report() const { return m_Report.load(std::memory_order_relaxed); }
+
+bool tpp::Profiler::Trace() const { return m_Trace.load(std::memory_order_relaxed); }
+
+unsigned tpp::Profiler::Granularity() const { return m_Granularity; }
+
+void tpp::Profiler::Add(ProfilePhase phase, std::chrono::steady_clock::duration duration)
+{
+	m_Nanoseconds[phase].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+	m_Counts[phase].fetch_add(1, std::memory_order_relaxed);
+}
+
+void tpp::Profiler::AddPass(std::string_view name, std::chrono::steady_clock::duration duration, uint64_t runs)
+{
+	if (!Report()) return;
+
+	std::lock_guard lock(m_Mutex);
+	auto it = m_Passes.find(name);
+	if (it == m_Passes.end()) it = m_Passes.emplace(std::string(name), std::pair<int64_t, uint64_t>()).first;
+	it->second.first += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+	it->second.second += runs;
+}
+
+void tpp::Profiler::PrintReport(llvm::raw_ostream &out) const
+{
+	auto total = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Begin).count();
+	auto row = [&out, total](double seconds, uint64_t count, llvm::StringRef name)
+	{ out << llvm::format("  %10.4f  %6.1f%%  %9llu  ", seconds, total > 0 ? seconds / total * 100 : 0, (unsigned long long) count) << name << '\n'; };
+
+	out << "===-------------------------------------------------------------------------===\n";
+	out << "                              t++ time report\n";
+	out << "===-------------------------------------------------------------------------===\n";
+	out << llvm::format("  Total: %.4f seconds; phases include their nested phases, worker threads add up\n\n", total);
+	out << "     Seconds   Percent      Count  Phase\n";
+	for (int phase = 0; phase < ProfilePhase_Count; ++phase)
+		if (auto count = m_Counts[phase].load()) row(m_Nanoseconds[phase].load() * 1e-9, count, PHASE_NAMES[phase]);
+
+	std::vector<std::pair<std::string, std::pair<int64_t, uint64_t>>> passes;
+	{
+		std::lock_guard lock(m_Mutex);
+		passes.assign(m_Passes.begin(), m_Passes.end());
+	}
+	if (passes.empty()) return;
+
+	std::stable_sort(passes.begin(), passes.end(), [](const auto &a, const auto &b) { return a.second.first > b.second.first; });
+
+	out << "\n     Seconds   Percent      Count  Pass (excluding nested passes)\n";
+	for (const auto &[name, entry] : passes) row(entry.first * 1e-9, entry.second, name);
+}
+
+void tpp::Profiler::WriteTrace(const std::string &filename)
+{
+	if (auto err = llvm::timeTraceProfilerWrite(filename, filename)) error(SourceLocation::UNKNOWN, "failed to write time trace %s: %s", filename.c_str(), llvm::toString(std::move(err)).c_str());
+	llvm::timeTraceProfilerCleanup();
+	m_Trace = false;
+}
+
+tpp::ProfileScope::ProfileScope(ProfilePhase phase, bool trace)
+	: m_Phase(phase), m_Report(Profiler::Global().Report()), m_Trace(trace && llvm::timeTraceProfilerEnabled())
+{
+	if (m_Trace) llvm::timeTraceProfilerBegin(PHASE_NAMES[phase], llvm::StringRef());
+	if (m_Report) m_Begin = std::chrono::steady_clock::now();
+}
+
+tpp::ProfileScope::ProfileScope(ProfilePhase phase, llvm::function_ref<std::string()> detail)
+	: m_Phase(phase), m_Report(Profiler::Global().Report()), m_Trace(llvm::timeTraceProfilerEnabled())
+{
+	if (m_Trace) llvm::timeTraceProfilerBegin(PHASE_NAMES[phase], detail);
+	if (m_Report) m_Begin = std::chrono::steady_clock::now();
+}
+
+tpp::ProfileScope::~ProfileScope()
+{
+	if (m_Report) Profiler::Global().Add(m_Phase, std::chrono::steady_clock::now() - m_Begin);
+	if (m_Trace) llvm::timeTraceProfilerEnd();
+}
+
+tpp::ProfileThread::ProfileThread()
+{
+	if (!Profiler::Global().Trace() || llvm::timeTraceProfilerEnabled()) return;
+
+	llvm::timeTraceProfilerInitialize(Profiler::Global().Granularity(), "t++");
+	m_Owner = true;
+}
+
+tpp::ProfileThread::~ProfileThread()
+{
+	if (m_Owner) llvm::timeTraceProfilerFinishThread();
+}
@@ -1,3 +1,19 @@
 #include <TPP/Frontend/SourceLocation.hpp>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
-const tpp::SourceLocation tpp::SourceLocation::UNKNOWN = { "unknown", 0, 0 };
+const tpp::SourceLocation tpp::SourceLocation::UNKNOWN = { tpp::SourceLocation::Intern("unknown"), 0, 0 };
+
+const std::filesystem::path *tpp::SourceLocation::Intern(const std::filesystem::path &filepath)
+{
+	static std::mutex mutex;
+	static std::deque<std::filesystem::path> paths;
+	static std::unordered_map<std::string, const std::filesystem::path *> interned;
+
+	std::lock_guard lock(mutex);
+	auto &ref = interned[filepath.string()];
+	if (!ref) ref = &paths.emplace_back(filepath);
+	return ref;
+}
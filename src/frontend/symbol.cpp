@@ -0,0 +1,62 @@
+#include <TPP/Frontend/Symbol.hpp>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	struct SymbolTable
+	{
+		SymbolTable()
+		{
+			// must match the order of the Keyword enum
+			for (auto keyword : { "", "include", "struct", "def", "for", "while", "if", "else", "pfor", "spawn", "sync" }) Insert(keyword);
+		}
+
+		uint32_t Insert(std::string_view string)
+		{
+			auto &stored = Strings.emplace_back(string);
+			auto id = (uint32_t) Views.size();
+			Views.push_back(stored);
+			Ids.emplace(stored, id);
+			return id;
+		}
+
+		std::shared_mutex Mutex;
+		std::deque<std::string> Strings;
+		std::vector<std::string_view> Views;
+		std::unordered_map<std::string_view, uint32_t> Ids;
+	};
+
+	SymbolTable &table()
+	{
+		static SymbolTable instance;
+		return instance;
+	}
+}
+
+tpp::Symbol tpp::Symbol::Get(std::string_view string)
+{
+	auto &t = table();
+
+	{
+		std::shared_lock lock(t.Mutex);
+		if (auto it = t.Ids.find(string); it != t.Ids.end()) return Symbol(it->second);
+	}
+
+	std::unique_lock lock(t.Mutex);
+	if (auto it = t.Ids.find(string); it != t.Ids.end()) return Symbol(it->second);
+	return Symbol(t.Insert(string));
+}
+
+std::string_view tpp::Symbol::String() const
+{
+	auto &t = table();
+	std::shared_lock lock(t.Mutex);
+	return t.Views[Id];
+}
+
+std::ostream &tpp::operator<<(std::ostream &out, Symbol symbol) { return out << symbol.String(); }
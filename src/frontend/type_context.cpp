@@ -0,0 +1,169 @@
+#include <TPP/Frontend/Frontend.hpp>
+#include <TPP/Frontend/Profiler.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <TPP/Frontend/StructElement.hpp>
+#include <TPP/Frontend/Type.hpp>
+#include <TPP/Frontend/TypeContext.hpp>
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <string>
+
+static size_t combine(size_t seed, size_t value) { return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2)); }
+
+tpp::TypeContext &tpp::TypeContext::Global()
+{
+	static TypeContext context;
+	return context;
+}
+
+tpp::TypeContext::TypeContext()
+{
+	static const char *names[] = { "", "i1", "i8", "i16", "i32", "i64", "i128", "f16", "f32", "f64", "void" };
+
+	for (int kind = TypeKind_I1; kind <= TypeKind_Void; ++kind)
+	{
+		auto &type = m_Primitives[kind] = std::make_shared<Type>((TypeKind) kind, names[kind]);
+		m_Named[Symbol::Get(type->Name)] = type;
+	}
+}
+
+tpp::Arena &tpp::TypeContext::GetArena() { return m_Arena; }
+
+const tpp::TypePtr &tpp::TypeContext::GetPrimitive(TypeKind kind) const { return m_Primitives[kind]; }
+
+tpp::TypePtr tpp::TypeContext::Get(Symbol name, bool unsafe)
+{
+	ProfileScope scope(ProfilePhase_TypeLookup, false);
+	std::lock_guard lock(m_Mutex);
+	if (auto it = m_Named.find(name); it != m_Named.end()) return it->second;
+	if (auto vector = GetVectorByName(name)) return vector;
+	if (!unsafe) error(SourceLocation::UNKNOWN, "no such type: %.*s", (int) name.String().size(), name.String().data());
+	return GetUnresolved(name);
+}
+
+tpp::TypePtr tpp::TypeContext::GetDeferred(Symbol name)
+{
+	ProfileScope scope(ProfilePhase_TypeLookup, false);
+	std::lock_guard lock(m_Mutex);
+	// only primitives are fixed, anything else may still be (re)defined before the builder sees it
+	if (auto it = m_Named.find(name); it != m_Named.end() && it->second->Kind != TypeKind_Struct) return it->second;
+	if (auto vector = GetVectorByName(name)) return vector;
+	return GetUnresolved(name);
+}
+
+tpp::TypePtr tpp::TypeContext::GetUnresolved(Symbol name)
+{
+	auto &ref = m_Unresolved[name];
+	if (!ref) ref = std::make_shared<Type>(TypeKind_Named, std::string(name.String()));
+	return ref;
+}
+
+tpp::TypePtr tpp::TypeContext::GetArray(const TypePtr &base)
+{
+	ProfileScope scope(ProfilePhase_TypeLookup, false);
+	std::lock_guard lock(m_Mutex);
+	auto &ref = m_Arrays[base.get()];
+	if (!ref) ref = std::make_shared<ArrayType>('[' + base->Name + ']', base);
+	return ref;
+}
+
+tpp::TypePtr tpp::TypeContext::GetFixedArray(const TypePtr &base, unsigned count)
+{
+	ProfileScope scope(ProfilePhase_TypeLookup, false);
+	std::lock_guard lock(m_Mutex);
+	auto &ref = m_FixedArrays[{ base.get(), count }];
+	if (!ref) ref = std::make_shared<FixedArrayType>(base->Name + '[' + std::to_string(count) + ']', base, count);
+	return ref;
+}
+
+tpp::TypePtr tpp::TypeContext::GetFunction(const TypePtr &result, const std::vector<TypePtr> &args, bool is_var_arg)
+{
+	ProfileScope scope(ProfilePhase_TypeLookup, false);
+	std::lock_guard lock(m_Mutex);
+	FunctionKey key{ result.get(), {}, is_var_arg };
+	key.Args.reserve(args.size());
+	for (const auto &arg : args) key.Args.push_back(arg.get());
+
+	auto &ref = m_Functions[std::move(key)];
+	if (ref) return ref;
+
+	std::string name = result->Name + '(';
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		if (i > 0) name += ',';
+		name += args[i]->Name;
+	}
+	name += ')';
+
+	return ref = std::make_shared<FunctionType>(name, result, args, is_var_arg);
+}
+
+tpp::TypePtr tpp::TypeContext::GetStruct(Symbol name, const std::vector<StructElement> &elements)
+{
+	ProfileScope scope(ProfilePhase_TypeLookup, false);
+	std::lock_guard lock(m_Mutex);
+	// structs are nominal, but redefining one with the same layout yields the same type
+	StructKey key{ name, {} };
+	key.Elements.reserve(elements.size());
+	for (const auto &element : elements) key.Elements.push_back(element.MType.get());
+
+	auto &ref = m_Structs[std::move(key)];
+	if (!ref) ref = std::make_shared<StructType>(std::string(name.String()), elements);
+	return m_Named[name] = ref;
+}
+
+tpp::TypePtr tpp::TypeContext::GetFuture(const TypePtr &base)
+{
+	ProfileScope scope(ProfilePhase_TypeLookup, false);
+	std::lock_guard lock(m_Mutex);
+	auto &ref = m_Futures[base.get()];
+	if (!ref) ref = std::make_shared<FutureType>("spawn " + base->Name, base);
+	return ref;
+}
+
+tpp::TypePtr tpp::TypeContext::GetVector(const TypePtr &base, unsigned count)
+{
+	ProfileScope scope(ProfilePhase_TypeLookup, false);
+	std::lock_guard lock(m_Mutex);
+	return GetVectorUnlocked(base, count);
+}
+
+tpp::TypePtr tpp::TypeContext::GetVectorUnlocked(const TypePtr &base, unsigned count)
+{
+	auto &ref = m_Vectors[{ base.get(), count }];
+	if (!ref) ref = std::make_shared<VectorType>('v' + std::to_string(count) + base->Name, base, count);
+	return ref;
+}
+
+tpp::TypePtr tpp::TypeContext::GetVectorByName(Symbol name)
+{
+	// 'v' followed by the lane count and a number type, like v4f64 or v8i32
+	auto string = name.String();
+	size_t end = 1;
+	while (end < string.size() && end < 4 && std::isdigit((unsigned char) string[end])) ++end;
+	if (string.size() < 3 || string[0] != 'v' || end == 1 || string[1] == '0') return nullptr;
+
+	auto count = (unsigned) std::stoul(std::string(string.substr(1, end - 1)));
+	auto base = m_Named.find(Symbol::Get(string.substr(end)));
+	if (count < 2 || base == m_Named.end() || base->second->Kind < TypeKind_I1 || base->second->Kind > TypeKind_F64) return nullptr;
+	return m_Named[name] = GetVectorUnlocked(base->second, count);
+}
+
+bool tpp::TypeContext::FunctionKey::operator==(const FunctionKey &other) const { return Result == other.Result && Args == other.Args && IsVarArg == other.IsVarArg; }
+
+bool tpp::TypeContext::StructKey::operator==(const StructKey &other) const { return Name == other.Name && Elements == other.Elements; }
+
+size_t tpp::TypeContext::KeyHash::operator()(const FunctionKey &key) const
+{
+	auto hash = combine(std::hash<const Type *>()(key.Result), key.IsVarArg);
+	for (auto arg : key.Args) hash = combine(hash, std::hash<const Type *>()(arg));
+	return hash;
+}
+
+size_t tpp::TypeContext::KeyHash::operator()(const StructKey &key) const
+{
+	auto hash = std::hash<Symbol>()(key.Name);
+	for (auto element : key.Elements) hash = combine(hash, std::hash<const Type *>()(element));
+	return hash;
+}
@@ -1,28 +1,229 @@
 #include <TPP/Backend/Builder.hpp>
+#include <TPP/Backend/JIT.hpp>
+#include <TPP/Backend/ObjectCache.hpp>
+#include <TPP/Backend/Optimizer.hpp>
+#include <TPP/Backend/ParallelBuilder.hpp>
+#include <TPP/Backend/Target.hpp>
+#include <TPP/Frontend/Arena.hpp>
+#include <TPP/Frontend/AstCache.hpp>
+#include <TPP/Frontend/DependencyGraph.hpp>
 #include <TPP/Frontend/Expression.hpp>
+#include <TPP/Frontend/Folder.hpp>
 #include <TPP/Frontend/Frontend.hpp>
 #include <TPP/Frontend/Name.hpp>
 #include <TPP/Frontend/Parser.hpp>
+#include <TPP/Frontend/Profiler.hpp>
+#include <TPP/Frontend/SourceLocation.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <vector>
+
+enum OutputMode
+{
+	OutputMode_IR,
+	OutputMode_Assembly,
+	OutputMode_Object,
+	OutputMode_Executable,
+	OutputMode_Run,
+};
+
+static int usage()
+{
+	std::cout << "usage: t++ [-O0|-O1|-O2|-O3] [--passes=<pipeline>] [-j <jobs>] [--cache-dir=<dir>] [--time-report] [-ftime-trace[=<file>]] [-emit-llvm|-S|-c] [-o <output>] <filename>" << std::endl;
+	std::cout << "       t++ [-O0|-O1|-O2|-O3] [--passes=<pipeline>] [-j <jobs>] [--cache-dir=<dir>] [--time-report] [-ftime-trace[=<file>]] --run <filename> [args...]" << std::endl;
+	return 1;
+}
+
+// strtoul with the whole argument consumed, so a malformed number is a usage error instead of an exception
+static bool parse_unsigned(const char *str, unsigned &value, unsigned min = 0)
+{
+	char *end;
+	errno = 0;
+	auto result = strtoul(str, &end, 10);
+	if (!isdigit((unsigned char) *str) || *end || errno || result > std::numeric_limits<unsigned>::max()) return false;
+	value = std::max(min, (unsigned) result);
+	return true;
+}
+
+static std::string default_output(const std::string &filename, OutputMode mode)
+{
+	std::filesystem::path path(filename);
+	switch (mode)
+	{
+	case OutputMode_IR: return "-";
+	case OutputMode_Assembly: return path.filename().replace_extension(".s").string();
+	case OutputMode_Object: return path.filename().replace_extension(".o").string();
+	case OutputMode_Executable: return "a.out";
+	case OutputMode_Run: return {};
+	default: tpp::error(tpp::SourceLocation::UNKNOWN, "missing switch case");
+	}
+}
 
 int main(const int argc, const char **argv)
 {
-	if (argc != 2)
+	auto level = tpp::OptLevel_O0;
+	auto mode = OutputMode_IR;
+	bool mode_set = false;
+	bool parallel = false;
+	unsigned jobs = 0;
+	std::string passes;
+	std::string cache_dir;
+	bool time_report = false;
+	bool time_trace = false;
+	unsigned time_trace_granularity = 0;
+	std::string time_trace_file;
+	std::string filename;
+	std::string output;
+	std::vector<std::string> args;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "-O0") level = tpp::OptLevel_O0;
+		else if (arg == "-O1") level = tpp::OptLevel_O1;
+		else if (arg == "-O2" || arg == "-O") level = tpp::OptLevel_O2;
+		else if (arg == "-O3") level = tpp::OptLevel_O3;
+		else if (arg.rfind("--passes=", 0) == 0) passes = arg.substr(9);
+		else if (arg.rfind("--cache-dir=", 0) == 0) cache_dir = arg.substr(12);
+		else if (arg == "--time-report") time_report = true;
+		else if (arg == "-ftime-trace") time_trace = true;
+		else if (arg.rfind("-ftime-trace=", 0) == 0) time_trace_file = arg.substr(13), time_trace = true;
+		else if (arg.rfind("-ftime-trace-granularity=", 0) == 0)
+		{
+			if (!parse_unsigned(arg.c_str() + 25, time_trace_granularity)) return usage();
+		}
+		else if (arg == "-emit-llvm") mode = OutputMode_IR, mode_set = true;
+		else if (arg == "-S") mode = OutputMode_Assembly, mode_set = true;
+		else if (arg == "-c") mode = OutputMode_Object, mode_set = true;
+		else if (arg == "-o" && i + 1 < argc) output = argv[++i];
+		else if ((arg == "-j" && i + 1 < argc) || (arg.rfind("-j", 0) == 0 && arg.size() > 2 && isdigit(arg[2])))
+		{
+			if (!parse_unsigned(arg.size() > 2 ? arg.c_str() + 2 : argv[++i], jobs)) return usage();
+			parallel = true;
+		}
+		else if (arg == "--run") mode = OutputMode_Run, mode_set = true;
+		else if (arg[0] != '-' && filename.empty())
+		{
+			filename = arg;
+			// everything after the input file is passed on to the jitted program
+			if (mode == OutputMode_Run)
+			{
+				args.assign(argv + i + 1, argv + argc);
+				break;
+			}
+		}
+		else return usage();
+	}
+
+	if (filename.empty()) return usage();
+
+	// '-o' without an explicit output kind links an executable
+	if (!mode_set && !output.empty()) mode = OutputMode_Executable;
+	if (output.empty()) output = default_output(filename, mode);
+
+	// like clang, the trace goes next to the output unless named explicitly; it is written once everything is done
+	if (time_trace && time_trace_file.empty()) time_trace_file = std::filesystem::path(mode == OutputMode_Run || output == "-" ? filename : output).replace_extension(".json").string();
+	if (time_report) tpp::Profiler::Global().EnableReport();
+	if (time_trace) tpp::Profiler::Global().EnableTrace(time_trace_granularity);
+
+	tpp::Target::Init();
+	tpp::Target target(level);
+
+	tpp::Optimizer optimizer(level, passes, &target.Machine());
+	tpp::Builder builder(filename, &optimizer);
+	target.Configure(builder.Module());
+
+	// folded nodes have to live as long as the bodies that refer to them
+	tpp::Folder folder;
+	auto fold = [&folder](const tpp::ExprPtr &ptr)
+	{
+		tpp::ProfileScope scope(tpp::ProfilePhase_Fold, false);
+		return folder.Fold(ptr);
+	};
+
+	std::unique_ptr<tpp::AstCache> cache;
+	if (!cache_dir.empty()) cache = std::make_unique<tpp::AstCache>(cache_dir);
+
+	if (parallel || cache)
+	{
+		// '-j 0' picks the hardware concurrency; the ast has to outlive parsing until all bodies are lowered
+		// with a cache directory the build is incremental: only source files whose bodies or included interfaces changed are lowered again
+		if (!parallel) jobs = 1;
+		tpp::Arena ast;
+		tpp::DependencyGraph graph;
+		std::unique_ptr<tpp::ObjectCache> objects;
+		if (cache) objects = std::make_unique<tpp::ObjectCache>(cache_dir, graph, level, passes, builder.Module());
+		tpp::ParallelBuilder parallel_builder(builder, level, passes, jobs, objects.get());
+		tpp::Parser::ParseFile(filename, ast, [&parallel_builder, &fold](const tpp::ExprPtr &ptr) { parallel_builder.GenIR(fold(ptr)); }, jobs, cache.get(), cache ? &graph : nullptr);
+		parallel_builder.Finish();
+	}
+	else
+		tpp::Parser::ParseFile(
+			filename,
+			[&builder, &fold](const tpp::ExprPtr &ptr)
+			{
+				// std::cout << ptr << std::endl;
+				auto folded = fold(ptr);
+				tpp::ProfileScope scope(tpp::ProfilePhase_GenIR, [&ptr] { return ptr->Location.Filepath->string() + ":" + std::to_string(ptr->Location.Row); });
+				builder.GenIR(folded);
+			});
+
+	builder.Finish();
 	{
-		std::cout << "usage: t++ <filename>" << std::endl;
-		return 1;
+		tpp::ProfileScope scope(tpp::ProfilePhase_Optimize);
+		optimizer.Run(builder.Module());
 	}
 
-	const std::string filename = argv[1];
-	tpp::Builder builder(filename);
+	int result = 0;
+	{
+		tpp::ProfileScope scope(mode == OutputMode_Run ? tpp::ProfilePhase_JIT : tpp::ProfilePhase_Emit);
+		switch (mode)
+		{
+		case OutputMode_IR:
+		{
+			std::error_code ec;
+			llvm::raw_fd_ostream stream(output, ec, llvm::sys::fs::OF_Text);
+			if (ec) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to open file %s: %s", output.c_str(), ec.message().c_str());
+			builder.Module().print(stream, nullptr);
+			break;
+		}
+
+		case OutputMode_Assembly: target.Emit(builder.Module(), output, llvm::CGFT_AssemblyFile); break;
+
+		case OutputMode_Object: target.Emit(builder.Module(), output, llvm::CGFT_ObjectFile); break;
 
-	tpp::Parser::ParseFile(
-		filename,
-		[&builder](const tpp::ExprPtr &ptr)
+		case OutputMode_Executable:
 		{
-			// std::cout << ptr << std::endl;
-			builder.GenIR(ptr);
-		});
+			llvm::SmallString<128> object;
+			if (auto ec = llvm::sys::fs::createTemporaryFile("t++", "o", object)) tpp::error(tpp::SourceLocation::UNKNOWN, "failed to create temporary file: %s", ec.message().c_str());
+			target.Emit(builder.Module(), object.str().str(), llvm::CGFT_ObjectFile);
+			tpp::Target::Link({ object.str().str() }, output);
+			llvm::sys::fs::remove(object);
+			break;
+		}
+
+		case OutputMode_Run:
+		{
+			tpp::JIT jit(level);
+			auto module = builder.ReleaseModule();
+			jit.Add(builder.ReleaseContext(), std::move(module));
+			result = jit.Run(filename, args);
+			break;
+		}
+		}
+	}
 
-	builder.Module().print(llvm::outs(), nullptr);
+	if (time_report) tpp::Profiler::Global().PrintReport(llvm::errs());
+	if (time_trace) tpp::Profiler::Global().WriteTrace(time_trace_file);
+	return result;
 }